@@ -0,0 +1,21 @@
+﻿/*******************************************************************************************************************
+* @file construcao.h
+* @author Diogo Oliveira (a20468@alunos.ipca.pt)
+* @brief header responsável pela declaraçao da construçao do grafo a partir de uma matriz
+* @date maio 2024 *
+*
+* @copyright Copyright (c) 2024
+*
+*******************************************************************************************************************/
+
+
+#ifndef CONSTRUCAO_H
+#define CONSTRUCAO_H
+
+#include "grafo.h"
+
+#define CONSTRUCAO_MAX_THREADS 64 /**< Limite de WaitForMultipleObjects */
+
+
+Grafo* construir_grafo_matriz(const int* matriz, int linhas, int colunas, int num_threads);
+#endif /* CONSTRUCAO_H */
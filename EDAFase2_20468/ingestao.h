@@ -0,0 +1,24 @@
+﻿/*******************************************************************************************************************
+* @file ingestao.h
+* @author Diogo Oliveira (a20468@alunos.ipca.pt)
+* @brief header responsável pela declaraçao da leitura em pipeline de uma matriz para um grafo
+* @date maio 2024 *
+*
+* @copyright Copyright (c) 2024
+*
+*******************************************************************************************************************/
+
+
+#ifndef INGESTAO_H
+#define INGESTAO_H
+
+#include "grafo.h"
+
+#define INGESTAO_MAX_THREADS 63              /**< Threads de conversao (mais a de leitura, limite de WaitForMultipleObjects) */
+#ifndef INGESTAO_TAMANHO_BLOCO
+#define INGESTAO_TAMANHO_BLOCO (1 << 20)     /**< Bytes lidos do ficheiro de cada vez */
+#endif
+#define INGESTAO_BLOCOS_POR_THREAD 2         /**< Capacidade das filas entre etapas, por thread de conversao */
+
+Grafo* ingerir_matriz(const char* nome_ficheiro, int num_threads);
+#endif /* INGESTAO_H */
@@ -11,6 +11,7 @@
 #include <stdio.h>
 #include "grafo.h"
 #include "bfs.h"
+#include "ingestao.h"
 
 #pragma comment(lib,"biblioteca.lib")
 
@@ -24,32 +25,14 @@
 
 int main() {
     int valor;
-    int matriz[5][5];
-    // Criando um grafo vazio
-    Grafo* grafo = criar_grafo();
-
-    // Lendo a matriz de adjacncia do arquivo "matriz.txt"
-    FILE* arquivo = fopen("matriz.txt", "r");
-    if (!arquivo) {
-        printf("Erro ao abrir o ficheiro\n");
+    // Ler a matriz de "matriz.txt" e construir o grafo ao mesmo tempo: um vertice por celula,
+    // ligado as celulas da mesma linha e coluna
+    Grafo* grafo = ingerir_matriz("matriz.txt", 0);
+    if (!grafo) {
+        printf("Erro ao ler o ficheiro\n");
         return 1;
     }
 
-    for (int i = 0; i < 5; ++i) {
-        for (int j = 0; j < 5; ++j) {
-            fscanf(arquivo, "%d;", &matriz[i][j]);
-            adicionar_vertice(grafo, matriz[i][j]);
-        }
-    }
-    fclose(arquivo);
-
-    for (int i = 0; i < 5; ++i) {
-        for (int j = 0; j < 5; ++j) {
-            conectar_vertices_linha(grafo, matriz, i, j);
-            conectar_vertices_coluna(grafo, matriz, i, j);
-        }
-    }
-
     imprimir_grafo(grafo);
 
     printf("-----------------------------\n");
@@ -5,6 +5,7 @@
 * Este ficheiro contm a implementao das funes necessrias para realizar a pesquisa em largura (BFS) em um grafo.
 * Inclui as seguintes funcionalidades:
 * - Criao e manipulao de uma fila para a BFS
+* - Fila sem trincos para varios produtores e consumidores, para pesquisas em paralelo
 * - Encontrar o caminho mais curto entre dois vrtices em um grafo
 * - Calcular a soma dos valores dos vrtices num caminho entre dois vrtices
 * @date maio 2024
@@ -13,36 +14,116 @@
 *
 *******************************************************************************************************************/
 
+#include <windows.h>
+#include <malloc.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "grafo.h"
 #include "bfs.h"
+#include "cache.h"
+
+
+#pragma region Funcoes Auxiliares
+/**
+ * @brief Menor potencia de 2 maior ou igual a n (e pelo menos FILA_CAPACIDADE_MINIMA)
+ *
+ * @return A capacidade, ou 0 se n exceder FILA_CAPACIDADE_MAXIMA
+ */
+static unsigned potencia_de_2(unsigned n) {
+    if (n > FILA_CAPACIDADE_MAXIMA) {
+        return 0;
+    }
+    unsigned capacidade = FILA_CAPACIDADE_MINIMA;
+    while (capacidade < n) {
+        capacidade <<= 1;
+    }
+    return capacidade;
+}
+
+/**
+ * @brief Passa os itens para um array novo com a capacidade pedida, ja pela ordem da fila
+ */
+static bool aumentar_fila(Fila* fila, unsigned capacidade) {
+    int* itens = (int*)_aligned_malloc((size_t)capacidade * sizeof(int), FILA_LINHA_CACHE);
+    if (itens == NULL) {
+        return false;
+    }
+    unsigned mascara = fila->capacidade - 1;
+    unsigned inicio = fila->frente & mascara;
+    unsigned primeira_parte = fila->capacidade - inicio;
+    if (primeira_parte > (unsigned)fila->tamanho) {
+        primeira_parte = (unsigned)fila->tamanho;
+    }
+    memcpy(itens, fila->itens + inicio, primeira_parte * sizeof(int));
+    memcpy(itens + primeira_parte, fila->itens, (fila->tamanho - primeira_parte) * sizeof(int));
+    _aligned_free(fila->itens);
+    fila->itens = itens;
+    fila->capacidade = capacidade;
+    fila->frente = 0;
+    fila->tras = (unsigned)fila->tamanho;
+    return true;
+}
+#pragma endregion
 
 
 #pragma region Criar Fila
 /**
  * @brief Cria uma nova fila com a capacidade especificada.
  *
- * @param capacidade Capacidade mxima da fila.
- * @return Ponteiro para a fila criada.
+ * A capacidade e arredondada para uma potencia de 2 e aumenta quando a fila enche.
+ *
+ * @param capacidade Capacidade inicial da fila (no maximo FILA_CAPACIDADE_MAXIMA).
+ * @return Ponteiro para a fila criada, ou NULL em caso de erro.
  * 
  * @autor Diogo Oliveira
  */
 Fila* criar_fila(unsigned capacidade) {
+    capacidade = potencia_de_2(capacidade);
+    if (capacidade == 0) {
+        return NULL;
+    }
     Fila* fila = (Fila*)malloc(sizeof(Fila));
+    if (fila == NULL) {
+        return NULL;
+    }
     fila->capacidade = capacidade;
-    fila->frente = fila->tamanho = 0;
-    fila->tras = capacidade - 1;
-    fila->itens = (int*)malloc(fila->capacidade * sizeof(int));
+    fila->frente = fila->tras = 0;
+    fila->tamanho = 0;
+    fila->itens = (int*)_aligned_malloc((size_t)fila->capacidade * sizeof(int), FILA_LINHA_CACHE);
+    if (fila->itens == NULL) {
+        free(fila);
+        return NULL;
+    }
     return fila;
 }
 #pragma endregion
 
 
+#pragma region Destruir Fila
+/**
+ * @brief Liberta uma fila criada com criar_fila.
+ *
+ * @param fila A fila a ser destruida.
+ * @return Verdadeiro se foi destruida, falso se a fila for NULL.
+ * 
+ * @autor Diogo Oliveira
+ */
+bool destruir_fila(Fila* fila) {
+    if (fila == NULL) {
+        return false;
+    }
+    _aligned_free(fila->itens);
+    free(fila);
+    return true;
+}
+#pragma endregion
+
+
 #pragma region Fila Cheia
 /**
- * @brief Verifica se a fila est cheia.
+ * @brief Verifica se a fila est cheia (o prximo enfileirar aumenta a capacidade).
  *
  * @param fila A fila a ser verificada.
  * @return Verdadeiro se a fila estiver cheia, falso caso contrrio.
@@ -50,7 +131,7 @@ Fila* criar_fila(unsigned capacidade) {
  * @autor Diogo Oliveira
  */
 bool fila_cheia(Fila* fila) {
-    return (fila->tamanho == fila->capacidade);
+    return ((unsigned)fila->tamanho == fila->capacidade);
 }
 #pragma endregion
 
@@ -72,20 +153,24 @@ bool fila_vazia(Fila* fila) {
 
 #pragma region Enfileirar
 /**
- * @brief Adiciona um valor (valor do vertice)  fila.
+ * @brief Adiciona um valor (valor do vertice)  fila, aumentando-a se estiver cheia.
  *
  * @param fila A fila onde o valor ser enfileirado.
  * @param item O valor a ser enfileirado.
+ * @return Verdadeiro se foi enfileirado, falso se nao foi possivel aumentar a fila (sem memoria ou
+ *         ja com FILA_CAPACIDADE_MAXIMA).
  * 
  * @autor Diogo Oliveira
  */
 bool enfileirar(Fila* fila, int item) {
-    if (fila_cheia(fila)) {
-        return;
+    if (fila_cheia(fila) &&
+        (fila->capacidade >= FILA_CAPACIDADE_MAXIMA || !aumentar_fila(fila, fila->capacidade << 1))) {
+        return false;
     }
-    fila->tras = (fila->tras + 1) % fila->capacidade;
-    fila->itens[fila->tras] = item;
+    fila->itens[fila->tras & (fila->capacidade - 1)] = item;
+    fila->tras++;
     fila->tamanho = fila->tamanho + 1;
+    return true;
 }
 #pragma endregion
 
@@ -95,7 +180,7 @@ bool enfileirar(Fila* fila, int item) {
  * @brief Remove e retorna o valor na frente da fila.
  *
  * @param fila A fila onde o valor ser removido.
- * @return O valor removido da fila.
+ * @return O valor removido da fila, ou -1 se a fila estiver vazia.
  * 
  * @autor Diogo Oliveira
  */
@@ -103,37 +188,263 @@ int desenfileirar(Fila* fila) {
     if (fila_vazia(fila)) {
         return -1;
     }
-    int item = fila->itens[fila->frente];
-    fila->frente = (fila->frente + 1) % fila->capacidade;
+    int item = fila->itens[fila->frente & (fila->capacidade - 1)];
+    fila->frente++;
     fila->tamanho = fila->tamanho - 1;
     return item;
 }
 #pragma endregion
 
 
-#pragma region Caminho Mais Curto
+#pragma region Enfileirar Lote
 /**
- * @brief Encontra o caminho mais curto entre dois vrtices em um grafo usando BFS.
+ * @brief Adiciona varios valores  fila de uma vez, com no maximo duas copias de memoria.
  *
- * @param grafo O grafo onde a procura ser realizada.
- * @param inicio O vrtice de incio do caminho.
- * @param destino O vrtice de destino do caminho.
+ * @param fila A fila onde os valores serao enfileirados.
+ * @param itens Os valores a enfileirar, por ordem.
+ * @param quantidade Numero de valores.
+ * @return Verdadeiro se foram todos enfileirados, falso se nao foi possivel aumentar a fila
+ *         (nesse caso a fila fica como estava).
  * 
  * @autor Diogo Oliveira
  */
-bool bfs_caminho_mais_curto(Grafo* grafo, int inicio, int destino) {
-    if (grafo == NULL || inicio >= grafo->num_vertices || destino >= grafo->num_vertices) {
+bool enfileirar_lote(Fila* fila, const int* itens, int quantidade) {
+    if (quantidade <= 0) {
+        return quantidade == 0;
+    }
+    unsigned necessario = (unsigned)fila->tamanho + (unsigned)quantidade;
+    if (necessario > fila->capacidade) {
+        unsigned capacidade = potencia_de_2(necessario);
+        if (capacidade == 0 || !aumentar_fila(fila, capacidade)) {
+            return false;
+        }
+    }
+    unsigned inicio = fila->tras & (fila->capacidade - 1);
+    unsigned primeira_parte = fila->capacidade - inicio;
+    if (primeira_parte > (unsigned)quantidade) {
+        primeira_parte = (unsigned)quantidade;
+    }
+    memcpy(fila->itens + inicio, itens, primeira_parte * sizeof(int));
+    memcpy(fila->itens, itens + primeira_parte, (quantidade - primeira_parte) * sizeof(int));
+    fila->tras += (unsigned)quantidade;
+    fila->tamanho = fila->tamanho + quantidade;
+    return true;
+}
+#pragma endregion
+
+
+#pragma region Desenfileirar Lote
+/**
+ * @brief Remove at maximo valores da frente da fila de uma vez.
+ *
+ * @param fila A fila de onde os valores serao removidos.
+ * @param itens Array onde sao escritos os valores removidos, por ordem.
+ * @param maximo Tamanho do array itens.
+ * @return O numero de valores removidos (0 se a fila estiver vazia).
+ * 
+ * @autor Diogo Oliveira
+ */
+int desenfileirar_lote(Fila* fila, int* itens, int maximo) {
+    int quantidade = fila->tamanho < maximo ? fila->tamanho : maximo;
+    if (quantidade <= 0) {
+        return 0;
+    }
+    unsigned inicio = fila->frente & (fila->capacidade - 1);
+    unsigned primeira_parte = fila->capacidade - inicio;
+    if (primeira_parte > (unsigned)quantidade) {
+        primeira_parte = (unsigned)quantidade;
+    }
+    memcpy(itens, fila->itens + inicio, primeira_parte * sizeof(int));
+    memcpy(itens + primeira_parte, fila->itens, (quantidade - primeira_parte) * sizeof(int));
+    fila->frente += (unsigned)quantidade;
+    fila->tamanho = fila->tamanho - quantidade;
+    return quantidade;
+}
+#pragma endregion
+
+
+#pragma region Criar Fila Concorrente
+/**
+ * @brief Cria uma fila limitada para varios produtores e consumidores, sem trincos.
+ *
+ * Ao contrario de Fila, a capacidade nao aumenta: enfileirar numa fila cheia falha. Serve para
+ * trabalho gerado durante a execucao (por exemplo vertices da fronteira de uma BFS paralela);
+ * para um intervalo fixo de tarefas basta um contador partilhado, como em centralidade.c e marcos.c.
+ *
+ * @param capacidade Capacidade da fila (arredondada para uma potencia de 2).
+ * @return Ponteiro para a fila criada, ou NULL em caso de erro.
+ * 
+ * @autor Diogo Oliveira
+ */
+FilaConcorrente* criar_fila_concorrente(unsigned capacidade) {
+    capacidade = potencia_de_2(capacidade);
+    if (capacidade == 0) {
+        return NULL;
+    }
+    FilaConcorrente* fila = (FilaConcorrente*)_aligned_malloc(sizeof(FilaConcorrente), FILA_LINHA_CACHE);
+    if (fila == NULL) {
+        return NULL;
+    }
+    fila->celulas = (CelulaFila*)_aligned_malloc((size_t)capacidade * sizeof(CelulaFila), FILA_LINHA_CACHE);
+    if (fila->celulas == NULL) {
+        _aligned_free(fila);
+        return NULL;
+    }
+    for (unsigned i = 0; i < capacidade; ++i) {
+        fila->celulas[i].sequencia = (long)i;
+    }
+    fila->mascara = capacidade - 1;
+    fila->tras = 0;
+    fila->frente = 0;
+    return fila;
+}
+#pragma endregion
+
+
+#pragma region Destruir Fila Concorrente
+/**
+ * @brief Liberta uma fila concorrente (nenhuma thread a pode estar a usar).
+ *
+ * @param fila A fila a ser destruida.
+ * @return Verdadeiro se foi destruida, falso se a fila for NULL.
+ * 
+ * @autor Diogo Oliveira
+ */
+bool destruir_fila_concorrente(FilaConcorrente* fila) {
+    if (fila == NULL) {
         return false;
     }
+    _aligned_free(fila->celulas);
+    _aligned_free(fila);
+    return true;
+}
+#pragma endregion
+
+
+#pragma region Enfileirar Concorrente
+/**
+ * @brief Adiciona um valor  fila concorrente; pode ser chamada por varias threads.
+ *
+ * O produtor reserva a posicao tras quando a sua sequencia indica que esta livre, escreve o
+ * item e so depois publica a sequencia posicao + 1, que a torna visivel aos consumidores. A
+ * sequencia e lida com ReadAcquire, para que o item escrito antes dela tambem seja visivel.
+ *
+ * @param fila A fila onde o valor ser enfileirado.
+ * @param item O valor a ser enfileirado.
+ * @return Verdadeiro se foi enfileirado, falso se a fila estiver cheia.
+ * 
+ * @autor Diogo Oliveira
+ */
+bool fila_concorrente_enfileirar(FilaConcorrente* fila, int item) {
+    unsigned long posicao = (unsigned long)ReadNoFence(&fila->tras);
+    CelulaFila* celula;
+    while (true) {
+        celula = &fila->celulas[posicao & fila->mascara];
+        long diferenca = (long)((unsigned long)ReadAcquire(&celula->sequencia) - posicao);
+        if (diferenca == 0) {
+            unsigned long anterior = (unsigned long)InterlockedCompareExchange(&fila->tras, (long)(posicao + 1), (long)posicao);
+            if (anterior == posicao) {
+                break;
+            }
+            posicao = anterior;
+        }
+        else if (diferenca < 0) {
+            // A posicao ainda tem o item de ha uma volta: a fila esta cheia
+            return false;
+        }
+        else {
+            posicao = (unsigned long)ReadNoFence(&fila->tras);
+        }
+    }
+    celula->item = item;
+    InterlockedExchange(&celula->sequencia, (long)(posicao + 1));
+    return true;
+}
+#pragma endregion
+
+
+#pragma region Desenfileirar Concorrente
+/**
+ * @brief Remove o valor da frente da fila concorrente; pode ser chamada por varias threads.
+ *
+ * @param fila A fila de onde o valor ser removido.
+ * @param item Onde  escrito o valor removido.
+ * @return Verdadeiro se foi removido um valor, falso se a fila estiver vazia.
+ * 
+ * @autor Diogo Oliveira
+ */
+bool fila_concorrente_desenfileirar(FilaConcorrente* fila, int* item) {
+    unsigned long posicao = (unsigned long)ReadNoFence(&fila->frente);
+    CelulaFila* celula;
+    while (true) {
+        celula = &fila->celulas[posicao & fila->mascara];
+        long diferenca = (long)((unsigned long)ReadAcquire(&celula->sequencia) - (posicao + 1));
+        if (diferenca == 0) {
+            unsigned long anterior = (unsigned long)InterlockedCompareExchange(&fila->frente, (long)(posicao + 1), (long)posicao);
+            if (anterior == posicao) {
+                break;
+            }
+            posicao = anterior;
+        }
+        else if (diferenca < 0) {
+            // A posicao ainda nao foi preenchida: a fila esta vazia
+            return false;
+        }
+        else {
+            posicao = (unsigned long)ReadNoFence(&fila->frente);
+        }
+    }
+    *item = celula->item;
+    // Livre para o produtor da volta seguinte
+    InterlockedExchange(&celula->sequencia, (long)(posicao + fila->mascara + 1));
+    return true;
+}
+#pragma endregion
+
+
+#pragma region Obter Caminho
+/**
+ * @brief Calcula o caminho mais curto entre dois vertices usando BFS.
+ *
+ * Se o grafo tiver uma cache de caminhos associada, o resultado e procurado primeiro na cache
+ * (para a versao atual do grafo) e, se for calculado, e guardado nela.
+ *
+ * @param grafo O grafo onde a procura sera realizada.
+ * @param inicio O vertice de inicio do caminho.
+ * @param destino O vertice de destino do caminho.
+ * @param caminho Array onde sao escritos os vertices do caminho, de inicio para destino.
+ * @param capacidade Tamanho do array caminho (num_vertices chega sempre).
+ * @param soma Onde e escrita a soma dos valores dos vertices do caminho, ou -1 (pode ser NULL).
+ * @return O numero de vertices do caminho, 0 se nao existir caminho, ou -1 em caso de erro.
+ *
+ * @autor Diogo Oliveira
+ */
+int bfs_obter_caminho(Grafo* grafo, int inicio, int destino, int* caminho, int capacidade, int* soma) {
+    if (grafo == NULL || caminho == NULL || inicio < 0 || destino < 0 ||
+        inicio >= grafo->num_vertices || destino >= grafo->num_vertices) {
+        return -1;
+    }
+    unsigned long long versao = grafo->versao;
+    int tamanho_caminho = cache_procurar(grafo->cache, inicio, destino, versao, caminho, capacidade, soma);
+    if (tamanho_caminho >= 0) {
+        return tamanho_caminho;
+    }
 
     bool* visitado = (bool*)malloc(grafo->num_vertices * sizeof(bool));
     int* predecessores = (int*)malloc(grafo->num_vertices * sizeof(int));
+    Fila* fila = criar_fila(grafo->num_vertices);
+    if (visitado == NULL || predecessores == NULL || fila == NULL) {
+        free(visitado);
+        free(predecessores);
+        destruir_fila(fila);
+        return -1;
+    }
     for (int i = 0; i < grafo->num_vertices; ++i) {
         visitado[i] = false;
         predecessores[i] = -1;
     }
 
-    Fila* fila = criar_fila(grafo->num_vertices);
+    // Nunca falha: a fila tem capacidade num_vertices e cada vertice entra no maximo uma vez
     enfileirar(fila, inicio);
     visitado[inicio] = true;
 
@@ -150,6 +461,7 @@ bool bfs_caminho_mais_curto(Grafo* grafo, int inicio, int destino) {
         while (aresta_atual) {
             int vertice_vizinho = aresta_atual->destino;
             if (!visitado[vertice_vizinho]) {
+                // Nunca falha (ver acima): so vertices ainda nao visitados entram na fila
                 enfileirar(fila, vertice_vizinho);
                 visitado[vertice_vizinho] = true;
                 predecessores[vertice_vizinho] = vertice_atual;
@@ -158,40 +470,80 @@ bool bfs_caminho_mais_curto(Grafo* grafo, int inicio, int destino) {
         }
     }
 
-    if (!visitado[destino]) {
-        printf("No existe caminho entre %d e %d\n", inicio, destino);
-    }
-    else {
+    int total = -1;
+    tamanho_caminho = 0;
+    if (visitado[destino]) {
         int atual = destino;
-        int tamanho_caminho = 0;
-
         while (atual != -1) {
             tamanho_caminho++;
             atual = predecessores[atual];
         }
 
-        int* caminho = (int*)malloc(tamanho_caminho * sizeof(int));
-        atual = destino;
-        int index = tamanho_caminho - 1;
-        while (atual != -1) {
-            caminho[index--] = atual;
-            atual = predecessores[atual];
+        if (tamanho_caminho > capacidade) {
+            tamanho_caminho = -1;
+        }
+        else {
+            total = 0;
+            atual = destino;
+            int index = tamanho_caminho - 1;
+            while (atual != -1) {
+                caminho[index--] = atual;
+                total += grafo->lista_adj[atual]->valor;
+                atual = predecessores[atual];
+            }
         }
+    }
+
+    free(visitado);
+    free(predecessores);
+    destruir_fila(fila);
+
+    if (tamanho_caminho >= 0) {
+        if (soma != NULL) {
+            *soma = total;
+        }
+        cache_inserir(grafo->cache, inicio, destino, versao, caminho, tamanho_caminho, total);
+    }
+    return tamanho_caminho;
+}
+#pragma endregion
+
+
+#pragma region Caminho Mais Curto
+/**
+ * @brief Encontra o caminho mais curto entre dois vrtices em um grafo usando BFS.
+ *
+ * @param grafo O grafo onde a procura ser realizada.
+ * @param inicio O vrtice de incio do caminho.
+ * @param destino O vrtice de destino do caminho.
+ * @return Verdadeiro se existir caminho, falso caso contrario.
+ * 
+ * @autor Diogo Oliveira
+ */
+bool bfs_caminho_mais_curto(Grafo* grafo, int inicio, int destino) {
+    if (grafo == NULL || inicio < 0 || destino < 0 || inicio >= grafo->num_vertices || destino >= grafo->num_vertices) {
+        return false;
+    }
+
+    int* caminho = (int*)malloc(grafo->num_vertices * sizeof(int));
+    if (caminho == NULL) {
+        return false;
+    }
+    int tamanho_caminho = bfs_obter_caminho(grafo, inicio, destino, caminho, grafo->num_vertices, NULL);
 
+    if (tamanho_caminho == 0) {
+        printf("No existe caminho entre %d e %d\n", inicio, destino);
+    }
+    else if (tamanho_caminho > 0) {
         printf("Caminho mais curto entre %d e %d: ", inicio, destino);
         for (int i = 0; i < tamanho_caminho; ++i) {
             printf("%d ", caminho[i]);
         }
         printf("\n");
-
-
-        free(caminho);
     }
 
-    free(visitado);
-    free(predecessores);
-    free(fila->itens);
-    free(fila);
+    free(caminho);
+    return tamanho_caminho > 0;
 }
 #pragma endregion
 
@@ -208,61 +560,22 @@ bool bfs_caminho_mais_curto(Grafo* grafo, int inicio, int destino) {
  * @autor Diogo Oliveira
  */
 int soma_valores_caminho(Grafo* grafo, int inicio, int destino) {
-    if (grafo == NULL || inicio >= grafo->num_vertices || destino >= grafo->num_vertices) {
+    if (grafo == NULL || inicio < 0 || destino < 0 || inicio >= grafo->num_vertices || destino >= grafo->num_vertices) {
         return -1;
     }
 
-    bool* visitado = (bool*)malloc(grafo->num_vertices * sizeof(bool));
-    int* predecessores = (int*)malloc(grafo->num_vertices * sizeof(int));
-    for (int i = 0; i < grafo->num_vertices; ++i) {
-        visitado[i] = false;
-        predecessores[i] = -1;
-    }
-
-    Fila* fila = criar_fila(grafo->num_vertices);
-    enfileirar(fila, inicio);
-    visitado[inicio] = true;
-
-    while (!fila_vazia(fila)) {
-        int vertice_atual = desenfileirar(fila);
-
-        if (vertice_atual == destino) {
-            break;
-        }
-
-        No* no_atual = grafo->lista_adj[vertice_atual];
-        Aresta* aresta_atual = no_atual->lista_arestas;
-
-        while (aresta_atual) {
-            int vertice_vizinho = aresta_atual->destino;
-            if (!visitado[vertice_vizinho]) {
-                enfileirar(fila, vertice_vizinho);
-                visitado[vertice_vizinho] = true;
-                predecessores[vertice_vizinho] = vertice_atual;
-            }
-            aresta_atual = aresta_atual->prox;
-        }
+    int* caminho = (int*)malloc(grafo->num_vertices * sizeof(int));
+    if (caminho == NULL) {
+        return -1;
     }
-
-    int soma = 0;
-    if (!visitado[destino]) {
+    int soma = -1;
+    int tamanho_caminho = bfs_obter_caminho(grafo, inicio, destino, caminho, grafo->num_vertices, &soma);
+    if (tamanho_caminho == 0) {
         printf("No existe caminho entre %d e %d\n", inicio, destino);
-        soma = -1;
     }
-    else {
-        int atual = destino;
-        while (atual != -1) {
-            soma += grafo->lista_adj[atual]->valor;
-            atual = predecessores[atual];
-        }
-    }
-
-    free(visitado);
-    free(predecessores);
-    free(fila->itens);
-    free(fila);
 
-    return soma;
+    free(caminho);
+    return tamanho_caminho > 0 ? soma : -1;
 }
 
 #pragma endregion
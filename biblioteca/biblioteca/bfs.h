@@ -17,24 +17,70 @@
  * @brief Definies e declaraes para o algoritmo de pesquisa em largura (BFS).
  */
 
+#define FILA_LINHA_CACHE 64          /**< Tamanho de uma linha de cache, para alinhamento e separacao */
+#define FILA_CAPACIDADE_MINIMA 16    /**< Capacidade inicial minima de uma Fila */
+#define FILA_CAPACIDADE_MAXIMA (1u << 30) /**< Capacidade maxima (tamanho e int e a duplicacao nao pode dar a volta) */
+
  /**
   * @struct Fila
   * @brief Estrutura de dados para uma fila utilizada na BFS.
+  *
+  * Buffer circular com capacidade potencia de 2, indexado com uma mascara em vez de '%', e que
+  * duplica de tamanho quando esta cheio. frente e tras avancam sem limite; a posicao no array e
+  * obtida com & (capacidade - 1).
   */
 typedef struct Fila {
-    int* itens; ///< Array para armazenar os itens da fila.
-    int frente; ///< ndice da frente da fila.
-    int tras;   ///< ndice da traseira da fila.
+    int* itens; ///< Array para armazenar os itens da fila (alinhado a FILA_LINHA_CACHE bytes).
+    unsigned frente; ///< Posio do item da frente da fila.
+    unsigned tras;   ///< Posio seguinte  traseira da fila.
     int tamanho; ///< Nmero atual de elementos na fila.
-    unsigned capacidade; ///< Capacidade mxima da fila.
+    unsigned capacidade; ///< Capacidade atual da fila (potncia de 2).
 } Fila;
 
+/**
+ * @struct CelulaFila
+ * @brief Posicao de uma FilaConcorrente: o numero de sequencia diz se a posicao esta livre ou ocupada.
+ *
+ * Cada posicao ocupa uma linha de cache inteira, para que produtores e consumidores em posicoes
+ * vizinhas nao invalidem a linha uns dos outros.
+ */
+typedef struct CelulaFila {
+    volatile long sequencia; ///< Igual a posicao quando livre, posicao + 1 quando ocupada.
+    int item;                ///< Item guardado.
+    char separador[FILA_LINHA_CACHE - sizeof(long) - sizeof(int)];
+} CelulaFila;
+
+/**
+ * @struct FilaConcorrente
+ * @brief Fila limitada sem trincos para varios produtores e varios consumidores.
+ *
+ * Cada posicao tem o seu numero de sequencia, por isso produtores e consumidores so competem
+ * pelos contadores tras e frente, que ficam em linhas de cache separadas, tal como cada posicao. A estrutura e alocada
+ * alinhada a FILA_LINHA_CACHE bytes.
+ */
+typedef struct FilaConcorrente {
+    volatile long tras;                                   ///< Proxima posicao a preencher (produtores).
+    char separador_tras[FILA_LINHA_CACHE - sizeof(long)];
+    volatile long frente;                                 ///< Proxima posicao a esvaziar (consumidores).
+    char separador_frente[FILA_LINHA_CACHE - sizeof(long)];
+    CelulaFila* celulas;                                  ///< Posicoes da fila (capacidade potencia de 2).
+    unsigned mascara;                                     ///< capacidade - 1.
+} FilaConcorrente;
+
 
 Fila* criar_fila(unsigned capacidade);
+bool destruir_fila(Fila* fila);
 bool fila_cheia(Fila* fila);
 bool fila_vazia(Fila* fila);
 bool enfileirar(Fila* fila, int item);
 int desenfileirar(Fila* fila);
+bool enfileirar_lote(Fila* fila, const int* itens, int quantidade);
+int desenfileirar_lote(Fila* fila, int* itens, int maximo);
+FilaConcorrente* criar_fila_concorrente(unsigned capacidade);
+bool destruir_fila_concorrente(FilaConcorrente* fila);
+bool fila_concorrente_enfileirar(FilaConcorrente* fila, int item);
+bool fila_concorrente_desenfileirar(FilaConcorrente* fila, int* item);
+int bfs_obter_caminho(Grafo* grafo, int inicio, int destino, int* caminho, int capacidade, int* soma);
 bool bfs_caminho_mais_curto(Grafo* grafo, int inicio, int destino);
 int soma_valores_caminho(Grafo* grafo, int inicio, int destino);
 
@@ -0,0 +1,269 @@
+﻿/*******************************************************************************************************************
+* @file cache.c
+* @brief Cache de resultados de caminhos, invalidada pela versao do grafo
+** @autor Diogo Oliveira (a20468@alunos.ipca.pt)
+* Este ficheiro contém a implementação das seguintes funcionalidades:
+* - Criação e destruição da cache associada a um grafo
+* - Consulta concorrente de caminhos e somas por (inicio, destino, versao)
+* - Insercao com substituicao CLOCK limitada pela memoria ocupada
+* @date maio 2024
+*
+* @copyright Copyright (c) 2024
+*
+*******************************************************************************************************************/
+
+
+
+#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+#include "grafo.h"
+#include "cache.h"
+
+#define CACHE_BYTES_POR_BALDE 256 /**< Memoria media prevista por entrada, para dimensionar a tabela */
+
+
+#pragma region Funcoes Auxiliares
+/**
+ * @brief Indice do balde de uma chave
+ */
+static unsigned int calcular_balde(CacheCaminhos* cache, int inicio, int destino, unsigned long long versao) {
+    unsigned int h = (unsigned int)inicio * 0x9E3779B1u;
+    h ^= (unsigned int)destino * 0x85EBCA77u + (h << 6) + (h >> 2);
+    h ^= (unsigned int)(versao ^ (versao >> 32)) * 0xC2B2AE3Du + (h << 6) + (h >> 2);
+    return h & (cache->num_baldes - 1);
+}
+
+/**
+ * @brief Memoria ocupada por uma entrada com o comprimento dado
+ */
+static size_t tamanho_entrada(int comprimento) {
+    return sizeof(EntradaCache) + (size_t)comprimento * sizeof(int);
+}
+
+/**
+ * @brief Retira uma entrada da tabela e do relogio e liberta-a
+ */
+static void remover_entrada(CacheCaminhos* cache, EntradaCache* entrada) {
+    EntradaCache** ligacao = &cache->baldes[calcular_balde(cache, entrada->inicio, entrada->destino, entrada->versao)];
+    while (*ligacao != entrada) {
+        ligacao = &(*ligacao)->prox;
+    }
+    *ligacao = entrada->prox;
+
+    // A ultima entrada do relogio ocupa o lugar da removida
+    EntradaCache* ultima = cache->relogio[--cache->num_entradas];
+    cache->relogio[entrada->posicao] = ultima;
+    ultima->posicao = entrada->posicao;
+    if (cache->ponteiro >= cache->num_entradas) {
+        cache->ponteiro = 0;
+    }
+    cache->bytes_usados -= tamanho_entrada(entrada->comprimento);
+    free(entrada);
+}
+
+/**
+ * @brief Escolhe uma vitima pelo algoritmo CLOCK (segunda oportunidade) e remove-a
+ */
+static void despejar_entrada(CacheCaminhos* cache) {
+    while (true) {
+        EntradaCache* entrada = cache->relogio[cache->ponteiro];
+        if (InterlockedExchange(&entrada->referenciada, 0) == 0) {
+            remover_entrada(cache, entrada);
+            return;
+        }
+        cache->ponteiro = (cache->ponteiro + 1) % cache->num_entradas;
+    }
+}
+#pragma endregion
+
+
+#pragma region Criar Cache
+/**
+ * @brief Cria uma cache de caminhos e associa-a ao grafo
+ *
+ * A partir deste momento bfs_caminho_mais_curto, soma_valores_caminho e bfs_obter_caminho
+ * consultam a cache antes de fazer a BFS. Cada alteracao do grafo incrementa grafo->versao, pelo
+ * que resultados anteriores deixam de ser encontrados e acabam por ser despejados.
+ *
+ * @param grafo Ponteiro para o grafo
+ * @param capacidade_bytes Memoria maxima ocupada pelas entradas
+ * @return Ponteiro para a cache, ou NULL em caso de erro
+ *
+ * @autor Diogo Oliveira
+ */
+CacheCaminhos* criar_cache_caminhos(Grafo* grafo, size_t capacidade_bytes) {
+    if (grafo == NULL || grafo->cache != NULL || capacidade_bytes < tamanho_entrada(0)) {
+        return NULL;
+    }
+    CacheCaminhos* cache = (CacheCaminhos*)calloc(1, sizeof(CacheCaminhos));
+    if (cache == NULL) {
+        return NULL;
+    }
+    cache->num_baldes = 16;
+    while (cache->num_baldes < capacidade_bytes / CACHE_BYTES_POR_BALDE && cache->num_baldes < (1u << 24)) {
+        cache->num_baldes <<= 1;
+    }
+    cache->baldes = (EntradaCache**)calloc(cache->num_baldes, sizeof(EntradaCache*));
+    cache->trinco = malloc(sizeof(SRWLOCK));
+    if (cache->baldes == NULL || cache->trinco == NULL) {
+        free(cache->baldes);
+        free(cache->trinco);
+        free(cache);
+        return NULL;
+    }
+    InitializeSRWLock((SRWLOCK*)cache->trinco);
+    cache->grafo = grafo;
+    cache->capacidade_bytes = capacidade_bytes;
+    grafo->cache = cache;
+    return cache;
+}
+#pragma endregion
+
+
+#pragma region Destruir Cache
+/**
+ * @brief Destroi a cache e desassocia-a do grafo
+ *
+ * @param cache Ponteiro para a cache
+ * @return true se foi destruida com sucesso, false caso contrario
+ *
+ * @autor Diogo Oliveira
+ */
+bool destruir_cache_caminhos(CacheCaminhos* cache) {
+    if (cache == NULL) {
+        return false;
+    }
+    if (cache->grafo != NULL && cache->grafo->cache == cache) {
+        cache->grafo->cache = NULL;
+    }
+    for (int i = 0; i < cache->num_entradas; ++i) {
+        free(cache->relogio[i]);
+    }
+    free(cache->relogio);
+    free(cache->baldes);
+    free(cache->trinco);
+    free(cache);
+    return true;
+}
+#pragma endregion
+
+
+#pragma region Procurar Cache
+/**
+ * @brief Procura o resultado de (inicio, destino) calculado na versao indicada do grafo
+ *
+ * Pode ser chamada por varias threads em simultaneo.
+ *
+ * @param cache Ponteiro para a cache
+ * @param inicio Vertice de inicio
+ * @param destino Vertice de destino
+ * @param versao Versao atual do grafo
+ * @param caminho Array onde e copiado o caminho (pode ser NULL se nao for necessario)
+ * @param capacidade Tamanho do array caminho
+ * @param soma Onde e escrita a soma dos valores do caminho (pode ser NULL)
+ * @return Numero de vertices do caminho (0 se nao existir caminho), ou -1 se nao estiver na cache
+ *         ou o caminho nao couber no array
+ *
+ * @autor Diogo Oliveira
+ */
+int cache_procurar(CacheCaminhos* cache, int inicio, int destino, unsigned long long versao, int* caminho, int capacidade, int* soma) {
+    if (cache == NULL) {
+        return -1;
+    }
+    int comprimento = -1;
+    AcquireSRWLockShared((SRWLOCK*)cache->trinco);
+    EntradaCache* entrada = cache->baldes[calcular_balde(cache, inicio, destino, versao)];
+    while (entrada) {
+        if (entrada->inicio == inicio && entrada->destino == destino && entrada->versao == versao) {
+            if (caminho == NULL || entrada->comprimento <= capacidade) {
+                if (caminho != NULL) {
+                    memcpy(caminho, entrada->caminho, entrada->comprimento * sizeof(int));
+                }
+                if (soma != NULL) {
+                    *soma = entrada->soma;
+                }
+                comprimento = entrada->comprimento;
+                if (entrada->referenciada == 0) {
+                    InterlockedExchange(&entrada->referenciada, 1);
+                }
+            }
+            break;
+        }
+        entrada = entrada->prox;
+    }
+    ReleaseSRWLockShared((SRWLOCK*)cache->trinco);
+    return comprimento;
+}
+#pragma endregion
+
+
+#pragma region Inserir Cache
+/**
+ * @brief Guarda o resultado de (inicio, destino) na versao indicada, despejando entradas se necessario
+ *
+ * @param cache Ponteiro para a cache
+ * @param inicio Vertice de inicio
+ * @param destino Vertice de destino
+ * @param versao Versao do grafo em que o resultado foi calculado
+ * @param caminho Vertices do caminho (pode ser NULL se comprimento for 0)
+ * @param comprimento Numero de vertices do caminho (0 se nao existir caminho)
+ * @param soma Soma dos valores dos vertices do caminho (-1 se nao existir caminho)
+ * @return true se foi guardado, false se nao cabe na cache ou ocorreu um erro
+ *
+ * @autor Diogo Oliveira
+ */
+bool cache_inserir(CacheCaminhos* cache, int inicio, int destino, unsigned long long versao, const int* caminho, int comprimento, int soma) {
+    if (cache == NULL || comprimento < 0 || tamanho_entrada(comprimento) > cache->capacidade_bytes) {
+        return false;
+    }
+    EntradaCache* nova = (EntradaCache*)malloc(tamanho_entrada(comprimento));
+    if (nova == NULL) {
+        return false;
+    }
+    nova->inicio = inicio;
+    nova->destino = destino;
+    nova->versao = versao;
+    nova->soma = soma;
+    nova->comprimento = comprimento;
+    nova->referenciada = 0;
+    if (comprimento > 0) {
+        memcpy(nova->caminho, caminho, comprimento * sizeof(int));
+    }
+
+    AcquireSRWLockExclusive((SRWLOCK*)cache->trinco);
+    unsigned int balde = calcular_balde(cache, inicio, destino, versao);
+    EntradaCache* existente = cache->baldes[balde];
+    while (existente) {
+        if (existente->inicio == inicio && existente->destino == destino && existente->versao == versao) {
+            // Outra thread ja guardou o mesmo resultado
+            ReleaseSRWLockExclusive((SRWLOCK*)cache->trinco);
+            free(nova);
+            return true;
+        }
+        existente = existente->prox;
+    }
+    while (cache->num_entradas > 0 && cache->bytes_usados + tamanho_entrada(comprimento) > cache->capacidade_bytes) {
+        despejar_entrada(cache);
+    }
+    if (cache->num_entradas == cache->cap_relogio) {
+        int nova_cap = cache->cap_relogio > 0 ? 2 * cache->cap_relogio : 64;
+        EntradaCache** novo_relogio = (EntradaCache**)realloc(cache->relogio, nova_cap * sizeof(EntradaCache*));
+        if (novo_relogio == NULL) {
+            ReleaseSRWLockExclusive((SRWLOCK*)cache->trinco);
+            free(nova);
+            return false;
+        }
+        cache->relogio = novo_relogio;
+        cache->cap_relogio = nova_cap;
+    }
+    balde = calcular_balde(cache, inicio, destino, versao);
+    nova->prox = cache->baldes[balde];
+    cache->baldes[balde] = nova;
+    nova->posicao = cache->num_entradas;
+    cache->relogio[cache->num_entradas++] = nova;
+    cache->bytes_usados += tamanho_entrada(comprimento);
+    ReleaseSRWLockExclusive((SRWLOCK*)cache->trinco);
+    return true;
+}
+#pragma endregion
@@ -0,0 +1,59 @@
+﻿/*******************************************************************************************************************
+* @file cache.h
+* @author Diogo Oliveira (a20468@alunos.ipca.pt)
+* @brief header responsável pela definiçao da cache de resultados de caminhos
+* @date maio 2024 *
+*
+* @copyright Copyright (c) 2024
+*
+*******************************************************************************************************************/
+
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "grafo.h"
+
+/**
+ * @brief Resultado guardado para um par (inicio, destino) numa versao do grafo
+ *
+ * @autor Diogo Oliveira
+ */
+typedef struct EntradaCache {
+    int inicio;                 /**< Vertice de inicio */
+    int destino;                /**< Vertice de destino */
+    unsigned long long versao;  /**< Versao do grafo em que o resultado foi calculado */
+    int soma;                   /**< Soma dos valores dos vertices do caminho (-1 se nao existir) */
+    int comprimento;            /**< Numero de vertices do caminho (0 se nao existir) */
+    volatile long referenciada; /**< Bit de referencia do algoritmo CLOCK */
+    int posicao;                /**< Posicao no relogio */
+    struct EntradaCache* prox;  /**< Proxima entrada no mesmo balde */
+    int caminho[];              /**< Vertices do caminho, de inicio para destino */
+} EntradaCache;
+
+/**
+ * @brief Cache limitada em bytes, com substituicao CLOCK e acesso concorrente para leitura
+ *
+ * @autor Diogo Oliveira
+ */
+typedef struct CacheCaminhos {
+    Grafo* grafo;                /**< Grafo ao qual a cache esta associada */
+    size_t capacidade_bytes;     /**< Memoria maxima ocupada pelas entradas */
+    size_t bytes_usados;         /**< Memoria ocupada pelas entradas atuais */
+    EntradaCache** baldes;       /**< Tabela de dispersao */
+    unsigned int num_baldes;     /**< Numero de baldes (potencia de 2) */
+    EntradaCache** relogio;      /**< Entradas pela ordem do relogio */
+    int num_entradas;            /**< Numero de entradas no relogio */
+    int cap_relogio;             /**< Capacidade alocada no relogio */
+    int ponteiro;                /**< Posicao atual do ponteiro do relogio */
+    void* trinco;                /**< SRWLOCK: partilhado nas consultas, exclusivo nas insercoes */
+} CacheCaminhos;
+
+
+CacheCaminhos* criar_cache_caminhos(Grafo* grafo, size_t capacidade_bytes);
+bool destruir_cache_caminhos(CacheCaminhos* cache);
+int cache_procurar(CacheCaminhos* cache, int inicio, int destino, unsigned long long versao, int* caminho, int capacidade, int* soma);
+bool cache_inserir(CacheCaminhos* cache, int inicio, int destino, unsigned long long versao, const int* caminho, int comprimento, int soma);
+#endif /* CACHE_H */
@@ -0,0 +1,213 @@
+﻿/*******************************************************************************************************************
+* @file centralidade.c
+* @brief Centralidade de intermediacao (algoritmo de Brandes) calculada em paralelo
+** @autor Diogo Oliveira (a20468@alunos.ipca.pt)
+* Este ficheiro contém a implementação das seguintes funcionalidades:
+* - Contagem de caminhos mais curtos a partir de cada vertice (BFS)
+* - Acumulacao das dependencias de cada vertice
+* - Distribuicao dos vertices de origem por varias threads, com acumuladores por thread
+* @date maio 2024
+*
+* @copyright Copyright (c) 2024
+*
+*******************************************************************************************************************/
+
+
+
+#include <windows.h>
+#include <stdlib.h>
+#include "grafo.h"
+#include "compacto.h"
+#include "centralidade.h"
+
+
+/**
+ * @brief Estado de cada thread: arrays de trabalho e acumulador proprios
+ */
+typedef struct TrabalhoCentralidade {
+    GrafoCompacto* compacto;     /**< Grafo partilhado, apenas lido */
+    volatile LONG* proxima_origem; /**< Contador partilhado com a proxima origem a processar */
+    double* acumulador;          /**< Centralidade acumulada por esta thread */
+    double* caminhos;            /**< Numero de caminhos mais curtos desde a origem (sigma) */
+    double* dependencia;         /**< Dependencia de cada vertice (delta) */
+    int* distancia;              /**< Distancia desde a origem */
+    int* ordem;                  /**< Vertices pela ordem da BFS (fila e depois pilha) */
+} TrabalhoCentralidade;
+
+
+#pragma region Funcoes Auxiliares
+/**
+ * @brief Processa uma origem: BFS com contagem de caminhos e acumulacao das dependencias
+ */
+static void processar_origem(TrabalhoCentralidade* trabalho, int origem) {
+    GrafoCompacto* compacto = trabalho->compacto;
+    double* caminhos = trabalho->caminhos;
+    double* dependencia = trabalho->dependencia;
+    int* distancia = trabalho->distancia;
+    int* ordem = trabalho->ordem;
+    int n = compacto->num_vertices;
+
+    for (int i = 0; i < n; ++i) {
+        distancia[i] = -1;
+        caminhos[i] = 0.0;
+        dependencia[i] = 0.0;
+    }
+    distancia[origem] = 0;
+    caminhos[origem] = 1.0;
+
+    // BFS: o array ordem serve de fila e guarda a ordem de visita
+    int frente = 0;
+    int tras = 0;
+    ordem[tras++] = origem;
+    while (frente < tras) {
+        int v = ordem[frente++];
+        for (int k = compacto->inicio[v]; k < compacto->inicio[v + 1]; ++k) {
+            int w = compacto->destino[k];
+            if (distancia[w] < 0) {
+                distancia[w] = distancia[v] + 1;
+                ordem[tras++] = w;
+            }
+            if (distancia[w] == distancia[v] + 1) {
+                caminhos[w] += caminhos[v];
+            }
+        }
+    }
+
+    // Percorrer a ordem ao contrario (pilha); os sucessores na arvore de caminhos sao os vizinhos
+    // a distancia + 1, o que evita guardar listas de predecessores
+    for (int i = tras - 1; i > 0; --i) {
+        int v = ordem[i];
+        for (int k = compacto->inicio[v]; k < compacto->inicio[v + 1]; ++k) {
+            int w = compacto->destino[k];
+            if (distancia[w] == distancia[v] + 1) {
+                dependencia[v] += caminhos[v] / caminhos[w] * (1.0 + dependencia[w]);
+            }
+        }
+        trabalho->acumulador[v] += dependencia[v];
+    }
+}
+
+/**
+ * @brief Funcao executada por cada thread: retira origens do contador partilhado ate se esgotarem
+ */
+static DWORD WINAPI executar_trabalho(LPVOID parametro) {
+    TrabalhoCentralidade* trabalho = (TrabalhoCentralidade*)parametro;
+    int n = trabalho->compacto->num_vertices;
+    LONG origem;
+    while ((origem = InterlockedIncrement(trabalho->proxima_origem) - 1) < n) {
+        processar_origem(trabalho, (int)origem);
+    }
+    return 0;
+}
+
+/**
+ * @brief Liberta os arrays de trabalho de uma thread
+ */
+static void libertar_trabalho(TrabalhoCentralidade* trabalho) {
+    free(trabalho->acumulador);
+    free(trabalho->caminhos);
+    free(trabalho->dependencia);
+    free(trabalho->distancia);
+    free(trabalho->ordem);
+}
+#pragma endregion
+
+
+#pragma region Centralidade Intermediacao
+/**
+ * @brief Calcula a centralidade de intermediacao de todos os vertices
+ *
+ * Para cada vertice v devolve a soma, sobre todos os pares (s, t) com s != v != t, da fracao
+ * de caminhos mais curtos de s para t que passam por v. As origens sao distribuidas
+ * dinamicamente pelas threads, cada uma com o seu acumulador; no fim os acumuladores sao somados.
+ *
+ * @param grafo Ponteiro para o grafo
+ * @param num_threads Numero de threads a usar (<= 0 para usar todos os processadores)
+ * @return Array com num_vertices valores (a libertar com free), ou NULL em caso de erro
+ *
+ * @autor Diogo Oliveira
+ */
+double* centralidade_intermediacao(Grafo* grafo, int num_threads) {
+    if (grafo == NULL) {
+        return NULL;
+    }
+    if (num_threads <= 0) {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        num_threads = (int)info.dwNumberOfProcessors;
+    }
+    if (num_threads > CENTRALIDADE_MAX_THREADS) {
+        num_threads = CENTRALIDADE_MAX_THREADS;
+    }
+    int n = grafo->num_vertices;
+    if (num_threads > n) {
+        num_threads = n > 0 ? n : 1;
+    }
+
+    double* resultado = (double*)calloc(n > 0 ? n : 1, sizeof(double));
+    GrafoCompacto* compacto = compactar_grafo(grafo);
+    TrabalhoCentralidade* trabalhos = (TrabalhoCentralidade*)calloc(num_threads, sizeof(TrabalhoCentralidade));
+    HANDLE* threads = (HANDLE*)calloc(num_threads, sizeof(HANDLE));
+    if (resultado == NULL || compacto == NULL || trabalhos == NULL || threads == NULL) {
+        free(resultado);
+        destruir_grafo_compacto(compacto);
+        free(trabalhos);
+        free(threads);
+        return NULL;
+    }
+
+    volatile LONG proxima_origem = 0;
+    bool erro = false;
+    for (int t = 0; t < num_threads; ++t) {
+        TrabalhoCentralidade* trabalho = &trabalhos[t];
+        trabalho->compacto = compacto;
+        trabalho->proxima_origem = &proxima_origem;
+        trabalho->acumulador = (double*)calloc(n > 0 ? n : 1, sizeof(double));
+        trabalho->caminhos = (double*)malloc((n > 0 ? n : 1) * sizeof(double));
+        trabalho->dependencia = (double*)malloc((n > 0 ? n : 1) * sizeof(double));
+        trabalho->distancia = (int*)malloc((n > 0 ? n : 1) * sizeof(int));
+        trabalho->ordem = (int*)malloc((n > 0 ? n : 1) * sizeof(int));
+        if (trabalho->acumulador == NULL || trabalho->caminhos == NULL || trabalho->dependencia == NULL ||
+            trabalho->distancia == NULL || trabalho->ordem == NULL) {
+            erro = true;
+        }
+    }
+
+    // A thread principal faz a parte da primeira thread; as restantes sao criadas
+    int criadas = 0;
+    if (!erro) {
+        for (int t = 1; t < num_threads; ++t) {
+            threads[criadas] = CreateThread(NULL, 0, executar_trabalho, &trabalhos[t], 0, NULL);
+            if (threads[criadas] != NULL) {
+                criadas++;
+            }
+        }
+        executar_trabalho(&trabalhos[0]);
+        if (criadas > 0) {
+            WaitForMultipleObjects(criadas, threads, TRUE, INFINITE);
+        }
+        for (int t = 0; t < criadas; ++t) {
+            CloseHandle(threads[t]);
+        }
+
+        // Reducao final dos acumuladores das threads
+        for (int t = 0; t < num_threads; ++t) {
+            for (int i = 0; i < n; ++i) {
+                resultado[i] += trabalhos[t].acumulador[i];
+            }
+        }
+    }
+
+    for (int t = 0; t < num_threads; ++t) {
+        libertar_trabalho(&trabalhos[t]);
+    }
+    free(trabalhos);
+    free(threads);
+    destruir_grafo_compacto(compacto);
+    if (erro) {
+        free(resultado);
+        return NULL;
+    }
+    return resultado;
+}
+#pragma endregion
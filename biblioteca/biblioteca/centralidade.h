@@ -0,0 +1,21 @@
+﻿/*******************************************************************************************************************
+* @file centralidade.h
+* @author Diogo Oliveira (a20468@alunos.ipca.pt)
+* @brief header responsável pela declaraçao das funções de centralidade de intermediacao
+* @date maio 2024 *
+*
+* @copyright Copyright (c) 2024
+*
+*******************************************************************************************************************/
+
+
+#ifndef CENTRALIDADE_H
+#define CENTRALIDADE_H
+
+#include "grafo.h"
+
+#define CENTRALIDADE_MAX_THREADS 64 /**< Limite de WaitForMultipleObjects */
+
+
+double* centralidade_intermediacao(Grafo* grafo, int num_threads);
+#endif /* CENTRALIDADE_H */
@@ -0,0 +1,106 @@
+﻿/*******************************************************************************************************************
+* @file compacto.c
+* @brief Conversao do grafo de listas ligadas para a representacao compacta (CSR)
+** @autor Diogo Oliveira (a20468@alunos.ipca.pt)
+* Este ficheiro contém a implementação das seguintes funcionalidades:
+* - Criação de uma copia compacta do grafo
+* - Destruição da copia compacta
+* @date maio 2024
+*
+* @copyright Copyright (c) 2024
+*
+*******************************************************************************************************************/
+
+
+
+#include <stdlib.h>
+#include "grafo.h"
+#include "compacto.h"
+
+
+#pragma region Compactar Grafo
+/**
+ * @brief Cria uma copia compacta do grafo
+ *
+ * @param grafo Ponteiro para o grafo
+ * @return Ponteiro para a copia compacta, ou NULL em caso de erro
+ *
+ * @autor Diogo Oliveira
+ */
+GrafoCompacto* compactar_grafo(Grafo* grafo) {
+    if (grafo == NULL) {
+        return NULL;
+    }
+    GrafoCompacto* compacto = (GrafoCompacto*)malloc(sizeof(GrafoCompacto));
+    if (compacto == NULL) {
+        return NULL;
+    }
+    int n = grafo->num_vertices;
+    compacto->num_vertices = n;
+    compacto->num_arestas = 0;
+    compacto->inicio = (int*)malloc((n + 1) * sizeof(int));
+    if (compacto->inicio == NULL) {
+        free(compacto);
+        return NULL;
+    }
+
+    // Primeira passagem: contar as arestas de cada vertice
+    compacto->inicio[0] = 0;
+    for (int i = 0; i < n; ++i) {
+        int grau = 0;
+        Aresta* aresta_atual = grafo->lista_adj[i]->lista_arestas;
+        while (aresta_atual) {
+            if (aresta_atual->destino < n) {
+                grau++;
+            }
+            aresta_atual = aresta_atual->prox;
+        }
+        compacto->inicio[i + 1] = compacto->inicio[i] + grau;
+    }
+    compacto->num_arestas = compacto->inicio[n];
+
+    // Segunda passagem: copiar as arestas
+    int tamanho = compacto->num_arestas > 0 ? compacto->num_arestas : 1;
+    compacto->destino = (int*)malloc(tamanho * sizeof(int));
+    compacto->valor = (int*)malloc(tamanho * sizeof(int));
+    if (compacto->destino == NULL || compacto->valor == NULL) {
+        destruir_grafo_compacto(compacto);
+        return NULL;
+    }
+    for (int i = 0; i < n; ++i) {
+        int k = compacto->inicio[i];
+        Aresta* aresta_atual = grafo->lista_adj[i]->lista_arestas;
+        while (aresta_atual) {
+            if (aresta_atual->destino < n) {
+                compacto->destino[k] = aresta_atual->destino;
+                compacto->valor[k] = aresta_atual->valor;
+                k++;
+            }
+            aresta_atual = aresta_atual->prox;
+        }
+    }
+    return compacto;
+}
+#pragma endregion
+
+
+#pragma region Destruir Grafo Compacto
+/**
+ * @brief Destroi a copia compacta, libertando toda a memoria alocada
+ *
+ * @param compacto Ponteiro para a copia compacta
+ * @return true se foi destruida com sucesso, false caso contrario
+ *
+ * @autor Diogo Oliveira
+ */
+bool destruir_grafo_compacto(GrafoCompacto* compacto) {
+    if (compacto == NULL) {
+        return false;
+    }
+    free(compacto->inicio);
+    free(compacto->destino);
+    free(compacto->valor);
+    free(compacto);
+    return true;
+}
+#pragma endregion
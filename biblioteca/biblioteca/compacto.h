@@ -0,0 +1,37 @@
+﻿/*******************************************************************************************************************
+* @file compacto.h
+* @author Diogo Oliveira (a20468@alunos.ipca.pt)
+* @brief header responsável pela definiçao da representaçao compacta (CSR) do grafo
+* @date maio 2024 *
+*
+* @copyright Copyright (c) 2024
+*
+*******************************************************************************************************************/
+
+
+#ifndef COMPACTO_H
+#define COMPACTO_H
+
+#include <stdbool.h>
+#include "grafo.h"
+
+/**
+ * @brief Copia so de leitura do grafo em arrays contiguos (Compressed Sparse Row)
+ *
+ * As arestas do vertice v ocupam as posicoes [inicio[v], inicio[v + 1]) de destino e valor.
+ * Por nao ter ponteiros, pode ser percorrida por varias threads em simultaneo.
+ *
+ * @autor Diogo Oliveira
+ */
+typedef struct GrafoCompacto {
+    int num_vertices; /**< Numero de vertices */
+    int num_arestas;  /**< Numero total de arestas */
+    int* inicio;      /**< Indice da primeira aresta de cada vertice (num_vertices + 1 posicoes) */
+    int* destino;     /**< Vertice de destino de cada aresta */
+    int* valor;       /**< Peso de cada aresta */
+} GrafoCompacto;
+
+
+GrafoCompacto* compactar_grafo(Grafo* grafo);
+bool destruir_grafo_compacto(GrafoCompacto* compacto);
+#endif /* COMPACTO_H */
@@ -0,0 +1,221 @@
+﻿/*******************************************************************************************************************
+* @file construcao.c
+* @brief Construcao paralela do grafo a partir de uma matriz de valores
+** @autor Diogo Oliveira (a20468@alunos.ipca.pt)
+* Este ficheiro contém a implementação das seguintes funcionalidades:
+* - Calculo antecipado do grau de cada vertice e alocacao de todos os vertices e arestas de uma so vez
+* - Ligacao dos vertices da mesma linha e da mesma coluna, repartida por threads sem trincos
+* - Calculo vetorial (SSE2) dos pesos das arestas de cada linha e coluna
+* @date maio 2024
+*
+* @copyright Copyright (c) 2024
+*
+*******************************************************************************************************************/
+
+
+
+#include <windows.h>
+#include <emmintrin.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "grafo.h"
+#include "construcao.h"
+
+
+/**
+ * @brief Trabalho de cada thread: um intervalo de linhas, cujos vertices lhe pertencem em exclusivo
+ */
+typedef struct TrabalhoConstrucao {
+    Grafo* grafo;            /**< Grafo em construcao */
+    const int* matriz;       /**< Matriz por linhas */
+    const int* transposta;   /**< Matriz por colunas, para ler cada coluna de forma contigua */
+    int linhas;              /**< Numero de linhas da matriz */
+    int colunas;             /**< Numero de colunas da matriz */
+    int linha_inicio;        /**< Primeira linha desta thread */
+    int linha_fim;           /**< Linha seguinte a ultima desta thread */
+    int* somas;              /**< Pesos calculados para a linha ou coluna atual */
+} TrabalhoConstrucao;
+
+
+#pragma region Funcoes Auxiliares
+/**
+ * @brief somas[k] = base + valores[k], quatro elementos de cada vez
+ */
+static void somar_vetor(int* somas, int base, const int* valores, int n) {
+    __m128i vetor_base = _mm_set1_epi32(base);
+    int k = 0;
+    for (; k + 4 <= n; k += 4) {
+        __m128i vetor = _mm_loadu_si128((const __m128i*)(valores + k));
+        _mm_storeu_si128((__m128i*)(somas + k), _mm_add_epi32(vetor_base, vetor));
+    }
+    for (; k < n; ++k) {
+        somas[k] = base + valores[k];
+    }
+}
+
+/**
+ * @brief Preenche os vertices e as arestas das linhas atribuidas a uma thread
+ *
+ * As arestas de cada vertice ficam pela mesma ordem que conectar_vertices_linha seguido de
+ * conectar_vertices_coluna produziriam: primeiro as da linha, depois as da coluna.
+ */
+static DWORD WINAPI construir_linhas(LPVOID parametro) {
+    TrabalhoConstrucao* trabalho = (TrabalhoConstrucao*)parametro;
+    Grafo* grafo = trabalho->grafo;
+    int linhas = trabalho->linhas;
+    int colunas = trabalho->colunas;
+    size_t grau = (size_t)(colunas - 1) + (size_t)(linhas - 1);
+
+    for (int i = trabalho->linha_inicio; i < trabalho->linha_fim; ++i) {
+        const int* linha = trabalho->matriz + (size_t)i * colunas;
+        for (int j = 0; j < colunas; ++j) {
+            int v = i * colunas + j;
+            No* no = &grafo->bloco_nos[v];
+            no->valor = linha[j];
+            no->prox = NULL;
+            no->lista_arestas = grau > 0 ? &grafo->bloco_arestas[(size_t)v * grau] : NULL;
+            grafo->lista_adj[v] = no;
+
+            Aresta* aresta = no->lista_arestas;
+            somar_vetor(trabalho->somas, linha[j], linha, colunas);
+            for (int k = 0; k < colunas; ++k) {
+                if (k != j) {
+                    aresta->origem = v;
+                    aresta->destino = i * colunas + k;
+                    aresta->valor = trabalho->somas[k];
+                    aresta->prox = aresta + 1;
+                    aresta++;
+                }
+            }
+            somar_vetor(trabalho->somas, linha[j], trabalho->transposta + (size_t)j * linhas, linhas);
+            for (int k = 0; k < linhas; ++k) {
+                if (k != i) {
+                    aresta->origem = v;
+                    aresta->destino = k * colunas + j;
+                    aresta->valor = trabalho->somas[k];
+                    aresta->prox = aresta + 1;
+                    aresta++;
+                }
+            }
+            if (grau > 0) {
+                (aresta - 1)->prox = NULL;
+            }
+        }
+    }
+    return 0;
+}
+#pragma endregion
+
+
+#pragma region Construir Grafo Matriz
+/**
+ * @brief Constroi o grafo de uma matriz, ligando cada celula as restantes da sua linha e coluna
+ *
+ * Equivale a adicionar um vertice por celula e chamar conectar_vertices_linha e
+ * conectar_vertices_coluna para todas as celulas, mas como o grau de cada vertice e conhecido,
+ * todos os vertices e arestas sao alocados de uma so vez e as linhas sao repartidas por threads.
+ * Cada thread so escreve nos vertices das suas linhas, por isso nao sao necessarios trincos.
+ *
+ * @param matriz Valores das celulas, linha a linha (linhas * colunas inteiros)
+ * @param linhas Numero de linhas da matriz
+ * @param colunas Numero de colunas da matriz
+ * @param num_threads Numero de threads a usar (<= 0 para usar todos os processadores)
+ * @return Ponteiro para o grafo construido, ou NULL em caso de erro ou se linhas * colunas exceder INT_MAX
+ *
+ * @autor Diogo Oliveira
+ */
+Grafo* construir_grafo_matriz(const int* matriz, int linhas, int colunas, int num_threads) {
+    if (matriz == NULL || linhas <= 0 || colunas <= 0) {
+        return NULL;
+    }
+    // Os indices dos vertices sao int, e o bloco de arestas (num_vertices * grau) tem de caber em size_t
+    size_t grau = (size_t)(colunas - 1) + (size_t)(linhas - 1);
+    if ((long long)linhas * colunas > INT_MAX ||
+        (grau > 0 && (size_t)linhas * colunas > SIZE_MAX / sizeof(Aresta) / grau)) {
+        return NULL;
+    }
+    if (num_threads <= 0) {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        num_threads = (int)info.dwNumberOfProcessors;
+    }
+    if (num_threads > CONSTRUCAO_MAX_THREADS) {
+        num_threads = CONSTRUCAO_MAX_THREADS;
+    }
+    if (num_threads > linhas) {
+        num_threads = linhas;
+    }
+
+    int num_vertices = linhas * colunas;
+    int maior = linhas > colunas ? linhas : colunas;
+
+    Grafo* grafo = criar_grafo();
+    int* transposta = (int*)malloc((size_t)num_vertices * sizeof(int));
+    TrabalhoConstrucao* trabalhos = (TrabalhoConstrucao*)calloc(num_threads, sizeof(TrabalhoConstrucao));
+    HANDLE* threads = (HANDLE*)calloc(num_threads, sizeof(HANDLE));
+    bool sucesso = grafo != NULL && transposta != NULL && trabalhos != NULL && threads != NULL;
+    if (sucesso) {
+        grafo->lista_adj = (No**)malloc(num_vertices * sizeof(No*));
+        grafo->bloco_nos = (No*)malloc(num_vertices * sizeof(No));
+        grafo->bloco_arestas = (Aresta*)malloc((grau > 0 ? (size_t)num_vertices * grau : 1) * sizeof(Aresta));
+        sucesso = grafo->lista_adj != NULL && grafo->bloco_nos != NULL && grafo->bloco_arestas != NULL;
+    }
+    for (int t = 0; sucesso && t < num_threads; ++t) {
+        trabalhos[t].somas = (int*)malloc(maior * sizeof(int));
+        sucesso = trabalhos[t].somas != NULL;
+    }
+
+    if (sucesso) {
+        grafo->tamanho_bloco_nos = num_vertices;
+        grafo->tamanho_bloco_arestas = (size_t)num_vertices * grau;
+        grafo->num_vertices = num_vertices;
+        for (int i = 0; i < linhas; ++i) {
+            for (int j = 0; j < colunas; ++j) {
+                transposta[(size_t)j * linhas + i] = matriz[(size_t)i * colunas + j];
+            }
+        }
+
+        // Repartir as linhas em blocos contiguos; a thread principal fica com o primeiro
+        int criadas = 0;
+        for (int t = 0; t < num_threads; ++t) {
+            trabalhos[t].grafo = grafo;
+            trabalhos[t].matriz = matriz;
+            trabalhos[t].transposta = transposta;
+            trabalhos[t].linhas = linhas;
+            trabalhos[t].colunas = colunas;
+            trabalhos[t].linha_inicio = (int)((long long)linhas * t / num_threads);
+            trabalhos[t].linha_fim = (int)((long long)linhas * (t + 1) / num_threads);
+        }
+        for (int t = 1; t < num_threads; ++t) {
+            threads[criadas] = CreateThread(NULL, 0, construir_linhas, &trabalhos[t], 0, NULL);
+            if (threads[criadas] == NULL) {
+                // Sem thread disponivel, o bloco e construido pela thread principal
+                construir_linhas(&trabalhos[t]);
+            }
+            else {
+                criadas++;
+            }
+        }
+        construir_linhas(&trabalhos[0]);
+        if (criadas > 0) {
+            WaitForMultipleObjects(criadas, threads, TRUE, INFINITE);
+        }
+        for (int t = 0; t < criadas; ++t) {
+            CloseHandle(threads[t]);
+        }
+    }
+
+    for (int t = 0; trabalhos != NULL && t < num_threads; ++t) {
+        free(trabalhos[t].somas);
+    }
+    free(trabalhos);
+    free(threads);
+    free(transposta);
+    if (!sucesso) {
+        destruir_grafo(grafo);
+        return NULL;
+    }
+    return grafo;
+}
+#pragma endregion
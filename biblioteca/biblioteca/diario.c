@@ -0,0 +1,476 @@
+﻿/*******************************************************************************************************************
+* @file diario.c
+* @brief Diario de alteraçoes do grafo com escrita em grupo e compactacao em segundo plano
+** @autor Diogo Oliveira (a20468@alunos.ipca.pt)
+* Este ficheiro contém a implementação das seguintes funcionalidades:
+* - Registo das alteracoes do grafo em registos binarios de tamanho fixo
+* - Escrita dos registos em grupos, com um unico fwrite e sincronizacao por grupo
+* - Compactacao em segundo plano do segmento anterior numa nova base
+* - Carregamento do grafo a partir da base e dos segmentos do diario
+* @date maio 2024
+*
+* @copyright Copyright (c) 2024
+*
+*******************************************************************************************************************/
+
+
+
+#include <windows.h>
+#include <io.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "grafo.h"
+#include "diario.h"
+
+
+#pragma region Funcoes Auxiliares
+/**
+ * @brief Le a geracao guardada no fim da base
+ *
+ * @return A geracao, 0 se a base nao tiver geracao (ficheiro de guardar_grafo_binario), ou -1 se nao existir
+ */
+static int ler_geracao_base(const char* nome_base) {
+    FILE* ficheiro = fopen(nome_base, "rb");
+    if (!ficheiro) {
+        return -1;
+    }
+    int rodape[2] = { 0, 0 };
+    int geracao = 0;
+    if (fseek(ficheiro, -(long)sizeof(rodape), SEEK_END) == 0 &&
+        fread(rodape, sizeof(int), 2, ficheiro) == 2 && rodape[0] == DIARIO_MARCA) {
+        geracao = rodape[1];
+    }
+    fclose(ficheiro);
+    return geracao;
+}
+
+/**
+ * @brief Escreve uma nova base no ficheiro temporario e substitui a atual de forma atomica
+ */
+static bool escrever_base(Grafo* grafo, const char* nome_temporario, const char* nome_base, int geracao) {
+    FILE* ficheiro = fopen(nome_temporario, "wb");
+    if (!ficheiro) {
+        return false;
+    }
+    int rodape[2] = { DIARIO_MARCA, geracao };
+    bool sucesso = escrever_grafo_binario(grafo, ficheiro) &&
+        fwrite(rodape, sizeof(int), 2, ficheiro) == 2 &&
+        fflush(ficheiro) == 0 && _commit(_fileno(ficheiro)) == 0;
+    if (fclose(ficheiro) != 0 || !sucesso) {
+        remove(nome_temporario);
+        return false;
+    }
+    return MoveFileExA(nome_temporario, nome_base, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+}
+
+/**
+ * @brief Cria um segmento vazio do diario, com o cabecalho da geracao indicada
+ */
+static FILE* criar_segmento(const char* nome_segmento, int geracao) {
+    FILE* ficheiro = fopen(nome_segmento, "wb");
+    if (!ficheiro) {
+        return NULL;
+    }
+    RegistoDiario cabecalho = { DIARIO_CABECALHO, DIARIO_MARCA, geracao, 0 };
+    if (fwrite(&cabecalho, sizeof(RegistoDiario), 1, ficheiro) != 1 || fflush(ficheiro) != 0) {
+        fclose(ficheiro);
+        return NULL;
+    }
+    return ficheiro;
+}
+
+/**
+ * @brief Le a geracao indicada no cabecalho de um segmento
+ *
+ * @return A geracao, ou -1 se o segmento nao existir ou nao tiver cabecalho valido
+ */
+static int ler_geracao_segmento(const char* nome_segmento) {
+    FILE* ficheiro = fopen(nome_segmento, "rb");
+    if (!ficheiro) {
+        return -1;
+    }
+    RegistoDiario cabecalho;
+    int geracao = -1;
+    if (fread(&cabecalho, sizeof(RegistoDiario), 1, ficheiro) == 1 &&
+        cabecalho.tipo == DIARIO_CABECALHO && cabecalho.a == DIARIO_MARCA) {
+        geracao = cabecalho.b;
+    }
+    fclose(ficheiro);
+    return geracao;
+}
+
+/**
+ * @brief Aplica ao grafo todos os registos de um segmento
+ *
+ * Um registo incompleto no fim (escrita interrompida) e ignorado.
+ */
+static bool reproduzir_segmento(Grafo* grafo, const char* nome_segmento) {
+    FILE* ficheiro = fopen(nome_segmento, "rb");
+    if (!ficheiro) {
+        return false;
+    }
+    RegistoDiario registos[256];
+    size_t lidos;
+    while ((lidos = fread(registos, sizeof(RegistoDiario), 256, ficheiro)) > 0) {
+        for (size_t i = 0; i < lidos; ++i) {
+            RegistoDiario* registo = &registos[i];
+            switch (registo->tipo) {
+            case DIARIO_ADICIONAR_VERTICE:
+                adicionar_vertice(grafo, registo->a);
+                break;
+            case DIARIO_ADICIONAR_ARESTA:
+                adicionar_aresta(grafo, registo->a, registo->b, registo->c);
+                break;
+            case DIARIO_REMOVER_VERTICE:
+                remover_vertice(grafo, registo->a);
+                break;
+            case DIARIO_REMOVER_ARESTA:
+                remover_aresta(grafo, registo->a, registo->b);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+    fclose(ficheiro);
+    return true;
+}
+
+/**
+ * @brief Reabre o segmento atual depois de uma falha que o deixou fechado
+ *
+ * Se o segmento da geracao atual existir, volta a ser aberto para acrescentar; caso contrario
+ * (por exemplo, se a sua criacao falhou durante uma compactacao) e criado de novo.
+ */
+static bool reabrir_segmento(Diario* diario) {
+    if (diario->ficheiro != NULL) {
+        return true;
+    }
+    if (ler_geracao_segmento(diario->nome_segmento) == diario->geracao) {
+        diario->ficheiro = fopen(diario->nome_segmento, "ab");
+    }
+    else {
+        diario->ficheiro = criar_segmento(diario->nome_segmento, diario->geracao);
+        diario->registos_no_segmento = 0;
+    }
+    return diario->ficheiro != NULL;
+}
+
+/**
+ * @brief Escreve os registos pendentes num unico fwrite e sincroniza o ficheiro com o disco
+ */
+static bool despejar_pendentes(Diario* diario) {
+    if (diario->num_pendentes == 0) {
+        return true;
+    }
+    if (!reabrir_segmento(diario) ||
+        fwrite(diario->pendentes, sizeof(RegistoDiario), diario->num_pendentes, diario->ficheiro) != (size_t)diario->num_pendentes ||
+        fflush(diario->ficheiro) != 0 || _commit(_fileno(diario->ficheiro)) != 0) {
+        return false;
+    }
+    diario->registos_no_segmento += diario->num_pendentes;
+    diario->num_pendentes = 0;
+    return true;
+}
+
+/**
+ * @brief Thread de compactacao: base + segmento antigo -> nova base
+ *
+ * Trabalha sobre uma copia carregada do disco, por isso nao toca no grafo em memoria. Tal como
+ * em carregar_grafo_diario, o segmento so e reproduzido se a base tiver a geracao sobre a qual
+ * ele foi escrito; se a base ja for mais recente, o segmento ja esta nela e apenas e apagado.
+ */
+static DWORD WINAPI compactar_em_fundo(LPVOID parametro) {
+    Diario* diario = (Diario*)parametro;
+    int geracao_base = ler_geracao_base(diario->nome_base);
+    if (geracao_base > diario->geracao_antigo) {
+        return remove(diario->nome_antigo) == 0 ? 0 : 1;
+    }
+    if (geracao_base != diario->geracao_antigo) {
+        return 1;
+    }
+    Grafo* grafo = carregar_grafo_binario(diario->nome_base);
+    if (grafo == NULL) {
+        return 1;
+    }
+    bool sucesso = reproduzir_segmento(grafo, diario->nome_antigo) &&
+        escrever_base(grafo, diario->nome_temporario, diario->nome_base, diario->geracao_antigo + 1);
+    destruir_grafo(grafo);
+    // So depois de a nova base estar no lugar o segmento antigo pode desaparecer; se falhar antes disso,
+    // a geracao da base indica na proxima leitura que o segmento ainda tem de ser reproduzido
+    if (sucesso) {
+        remove(diario->nome_antigo);
+    }
+    return sucesso ? 0 : 1;
+}
+
+/**
+ * @brief Espera pela thread de compactacao, se existir
+ *
+ * @param espera Tempo maximo de espera em milissegundos (0 apenas verifica se terminou)
+ * @return true se nao ha nenhuma compactacao a decorrer
+ */
+static bool terminar_compactacao(Diario* diario, DWORD espera) {
+    if (diario->compactacao == NULL) {
+        return true;
+    }
+    if (WaitForSingleObject((HANDLE)diario->compactacao, espera) != WAIT_OBJECT_0) {
+        return false;
+    }
+    CloseHandle((HANDLE)diario->compactacao);
+    diario->compactacao = NULL;
+    return true;
+}
+#pragma endregion
+
+
+#pragma region Abrir Diario
+/**
+ * @brief Guarda uma base nova do grafo e passa a registar todas as suas alteracoes
+ *
+ * A partir deste momento adicionar_vertice, adicionar_aresta, remover_vertice e remover_aresta
+ * acrescentam registos ao diario; diario_confirmar torna-os persistentes.
+ *
+ * @param grafo Ponteiro para o grafo
+ * @param nome_base Nome do ficheiro da base (os segmentos usam o mesmo nome com sufixo)
+ * @param registos_por_grupo Registos acumulados em memoria antes de serem escritos de uma vez
+ * @param limite_compactacao Registos no segmento a partir dos quais se inicia uma compactacao
+ * @return Ponteiro para o diario, ou NULL em caso de erro
+ *
+ * @autor Diogo Oliveira
+ */
+Diario* abrir_diario(Grafo* grafo, const char* nome_base, int registos_por_grupo, int limite_compactacao) {
+    if (grafo == NULL || grafo->diario != NULL || nome_base == NULL ||
+        strlen(nome_base) >= DIARIO_MAX_NOME || registos_por_grupo <= 0) {
+        return NULL;
+    }
+    Diario* diario = (Diario*)calloc(1, sizeof(Diario));
+    if (diario == NULL) {
+        return NULL;
+    }
+    diario->pendentes = (RegistoDiario*)malloc(registos_por_grupo * sizeof(RegistoDiario));
+    if (diario->pendentes == NULL) {
+        free(diario);
+        return NULL;
+    }
+    diario->grafo = grafo;
+    diario->cap_pendentes = registos_por_grupo;
+    diario->registos_por_grupo = registos_por_grupo;
+    diario->limite_compactacao = limite_compactacao;
+    strcpy(diario->nome_base, nome_base);
+    snprintf(diario->nome_segmento, sizeof(diario->nome_segmento), "%s.diario", nome_base);
+    snprintf(diario->nome_antigo, sizeof(diario->nome_antigo), "%s.diario.antigo", nome_base);
+    snprintf(diario->nome_temporario, sizeof(diario->nome_temporario), "%s.tmp", nome_base);
+
+    // A nova base ja contem tudo o que os segmentos existentes descreviam
+    diario->geracao = ler_geracao_base(nome_base) + 1;
+    if (!escrever_base(grafo, diario->nome_temporario, nome_base, diario->geracao)) {
+        free(diario->pendentes);
+        free(diario);
+        return NULL;
+    }
+    remove(diario->nome_antigo);
+    diario->ficheiro = criar_segmento(diario->nome_segmento, diario->geracao);
+    if (diario->ficheiro == NULL) {
+        free(diario->pendentes);
+        free(diario);
+        return NULL;
+    }
+    grafo->diario = diario;
+    return diario;
+}
+#pragma endregion
+
+
+#pragma region Fechar Diario
+/**
+ * @brief Escreve os registos pendentes, espera pela compactacao e desassocia o diario do grafo
+ *
+ * @param diario Ponteiro para o diario
+ * @return true se todos os registos ficaram persistentes, false caso contrario
+ *
+ * @autor Diogo Oliveira
+ */
+bool fechar_diario(Diario* diario) {
+    if (diario == NULL) {
+        return false;
+    }
+    bool sucesso = despejar_pendentes(diario);
+    terminar_compactacao(diario, INFINITE);
+    if (diario->ficheiro != NULL && fclose(diario->ficheiro) != 0) {
+        sucesso = false;
+    }
+    if (diario->grafo != NULL && diario->grafo->diario == diario) {
+        diario->grafo->diario = NULL;
+    }
+    free(diario->pendentes);
+    free(diario);
+    return sucesso;
+}
+#pragma endregion
+
+
+#pragma region Registar Alteracao
+/**
+ * @brief Acrescenta uma alteracao ao grupo atual; o grupo e escrito quando fica cheio
+ *
+ * Chamada pelas funcoes de grafo.c que alteram o grafo. Se a escrita do grupo falhar, os registos
+ * continuam em memoria (o buffer cresce) e a escrita e tentada de novo no registo seguinte.
+ *
+ * @param diario Ponteiro para o diario (pode ser NULL)
+ * @param tipo Tipo de registo (TipoRegisto)
+ * @return true se foi registada com sucesso, false se nao havia memoria ou o grupo nao pode ser escrito
+ *
+ * @autor Diogo Oliveira
+ */
+bool diario_registar(Diario* diario, int tipo, int a, int b, int c) {
+    if (diario == NULL) {
+        return false;
+    }
+    if (diario->num_pendentes == diario->cap_pendentes) {
+        if (diario->cap_pendentes > INT_MAX / 2) {
+            return false;
+        }
+        int nova_capacidade = diario->cap_pendentes * 2;
+        RegistoDiario* novos = (RegistoDiario*)realloc(diario->pendentes, nova_capacidade * sizeof(RegistoDiario));
+        if (novos == NULL) {
+            return false;
+        }
+        diario->pendentes = novos;
+        diario->cap_pendentes = nova_capacidade;
+    }
+    RegistoDiario* registo = &diario->pendentes[diario->num_pendentes++];
+    registo->tipo = tipo;
+    registo->a = a;
+    registo->b = b;
+    registo->c = c;
+    if (diario->num_pendentes >= diario->registos_por_grupo) {
+        return diario_confirmar(diario);
+    }
+    return true;
+}
+#pragma endregion
+
+
+#pragma region Confirmar Diario
+/**
+ * @brief Torna persistentes as alteracoes registadas (escrita em grupo)
+ *
+ * O custo e proporcional ao numero de alteracoes desde a ultima confirmacao. Se o segmento
+ * ultrapassar o limite de compactacao, e iniciada uma compactacao em segundo plano. Se o segmento
+ * tiver ficado fechado por uma falha anterior, e reaberto antes da escrita.
+ *
+ * @param diario Ponteiro para o diario
+ * @return true se os registos foram escritos com sucesso, false caso contrario
+ *
+ * @autor Diogo Oliveira
+ */
+bool diario_confirmar(Diario* diario) {
+    if (diario == NULL || !despejar_pendentes(diario)) {
+        return false;
+    }
+    if (diario->limite_compactacao > 0 && diario->registos_no_segmento >= diario->limite_compactacao) {
+        diario_compactar(diario);
+    }
+    return true;
+}
+#pragma endregion
+
+
+#pragma region Compactar Diario
+/**
+ * @brief Fecha o segmento atual e incorpora-o na base numa thread em segundo plano
+ *
+ * Os novos registos passam a ir para um segmento novo, pelo que o grafo pode continuar a ser
+ * alterado durante a compactacao.
+ *
+ * @param diario Ponteiro para o diario
+ * @return true se a compactacao foi iniciada, false se ja havia uma a decorrer ou ocorreu um erro
+ *
+ * @autor Diogo Oliveira
+ */
+bool diario_compactar(Diario* diario) {
+    if (diario == NULL || !despejar_pendentes(diario) || !terminar_compactacao(diario, 0)) {
+        return false;
+    }
+
+    // Se uma compactacao anterior falhou, o segmento antigo continua a existir e e tentado de novo.
+    // Se a base ja o incorporou (so a remocao do segmento falhou, aqui ou em abrir_diario), voltar
+    // a reproduzi-lo duplicaria os registos: e apagado e o segmento atual passa a ser o antigo
+    int geracao_antigo = ler_geracao_segmento(diario->nome_antigo);
+    if (geracao_antigo >= 0 && ler_geracao_base(diario->nome_base) > geracao_antigo) {
+        if (remove(diario->nome_antigo) != 0) {
+            return false;
+        }
+        geracao_antigo = -1;
+    }
+    if (geracao_antigo < 0) {
+        // Se alguma destas operacoes falhar, o segmento fica fechado e reabrir_segmento volta a
+        // abri-lo (ou a cria-lo) na proxima escrita, pelo que nenhum registo se perde
+        if (diario->ficheiro != NULL && fclose(diario->ficheiro) != 0) {
+            diario->ficheiro = NULL;
+            return false;
+        }
+        diario->ficheiro = NULL;
+        if (!MoveFileExA(diario->nome_segmento, diario->nome_antigo, MOVEFILE_WRITE_THROUGH)) {
+            reabrir_segmento(diario);
+            return false;
+        }
+        geracao_antigo = diario->geracao;
+        diario->geracao++;
+        diario->ficheiro = criar_segmento(diario->nome_segmento, diario->geracao);
+        diario->registos_no_segmento = 0;
+        if (diario->ficheiro == NULL) {
+            return false;
+        }
+    }
+
+    diario->geracao_antigo = geracao_antigo;
+    diario->compactacao = CreateThread(NULL, 0, compactar_em_fundo, diario, 0, NULL);
+    return diario->compactacao != NULL;
+}
+#pragma endregion
+
+
+#pragma region Carregar Grafo Diario
+/**
+ * @brief Carrega o grafo reproduzindo a base e os segmentos do diario
+ *
+ * @param nome_base Nome do ficheiro da base usado em abrir_diario
+ * @return Ponteiro para o grafo carregado (sem diario associado), ou NULL em caso de erro
+ *
+ * @autor Diogo Oliveira
+ */
+Grafo* carregar_grafo_diario(const char* nome_base) {
+    if (nome_base == NULL || strlen(nome_base) >= DIARIO_MAX_NOME) {
+        return NULL;
+    }
+    char nome_segmento[DIARIO_MAX_NOME + 16];
+    char nome_antigo[DIARIO_MAX_NOME + 16];
+    snprintf(nome_segmento, sizeof(nome_segmento), "%s.diario", nome_base);
+    snprintf(nome_antigo, sizeof(nome_antigo), "%s.diario.antigo", nome_base);
+
+    int geracao = ler_geracao_base(nome_base);
+    Grafo* grafo = carregar_grafo_binario(nome_base);
+    if (grafo == NULL) {
+        return NULL;
+    }
+
+    // Um segmento antigo com geracao anterior a da base ja foi incorporado nela
+    bool sucesso = true;
+    if (ler_geracao_segmento(nome_antigo) == geracao) {
+        sucesso = reproduzir_segmento(grafo, nome_antigo);
+        geracao++;
+    }
+    if (sucesso && ler_geracao_segmento(nome_segmento) == geracao) {
+        sucesso = reproduzir_segmento(grafo, nome_segmento);
+    }
+    if (!sucesso) {
+        destruir_grafo(grafo);
+        return NULL;
+    }
+    return grafo;
+}
+#pragma endregion
@@ -0,0 +1,79 @@
+﻿/*******************************************************************************************************************
+* @file diario.h
+* @author Diogo Oliveira (a20468@alunos.ipca.pt)
+* @brief header responsável pela definiçao do diario de alteraçoes do grafo (write-ahead journal)
+* @date maio 2024 *
+*
+* @copyright Copyright (c) 2024
+*
+*******************************************************************************************************************/
+
+
+#ifndef DIARIO_H
+#define DIARIO_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "grafo.h"
+
+#define DIARIO_MAX_NOME 260       /**< Tamanho maximo do nome do ficheiro base */
+#define DIARIO_MARCA 0x4F495244   /**< Identifica cabecalhos de segmentos e a geracao no fim da base */
+
+/**
+ * @brief Tipos de registo do diario
+ */
+typedef enum TipoRegisto {
+    DIARIO_CABECALHO = 0,         /**< Primeiro registo de cada segmento: a = DIARIO_MARCA, b = geracao */
+    DIARIO_ADICIONAR_VERTICE = 1, /**< a = valor */
+    DIARIO_ADICIONAR_ARESTA = 2,  /**< a = origem, b = destino, c = valor */
+    DIARIO_REMOVER_VERTICE = 3,   /**< a = valor */
+    DIARIO_REMOVER_ARESTA = 4     /**< a = origem, b = destino */
+} TipoRegisto;
+
+/**
+ * @brief Registo binario de tamanho fixo com uma alteracao do grafo
+ *
+ * @autor Diogo Oliveira
+ */
+typedef struct RegistoDiario {
+    int tipo; /**< Um dos valores de TipoRegisto */
+    int a;    /**< Primeiro argumento */
+    int b;    /**< Segundo argumento */
+    int c;    /**< Terceiro argumento */
+} RegistoDiario;
+
+/**
+ * @brief Diario associado a um grafo
+ *
+ * Em disco existem a base (<nome>, no formato de guardar_grafo_binario seguido da geracao), o
+ * segmento atual (<nome>.diario) e, durante uma compactacao, o segmento anterior (<nome>.diario.antigo).
+ * Cada segmento comeca com a geracao da base sobre a qual deve ser reproduzido.
+ *
+ * @autor Diogo Oliveira
+ */
+typedef struct Diario {
+    Grafo* grafo;                              /**< Grafo cujas alteracoes sao registadas */
+    char nome_base[DIARIO_MAX_NOME];           /**< Ficheiro com a base */
+    char nome_segmento[DIARIO_MAX_NOME + 16];  /**< Segmento atual do diario */
+    char nome_antigo[DIARIO_MAX_NOME + 16];    /**< Segmento a ser incorporado na base */
+    char nome_temporario[DIARIO_MAX_NOME + 16]; /**< Base nova, antes de substituir a atual */
+    FILE* ficheiro;                            /**< Segmento atual, aberto para acrescentar (NULL se tiver de ser reaberto) */
+    int geracao;                               /**< Geracao sobre a qual o segmento atual e reproduzido */
+    int geracao_antigo;                        /**< Geracao do segmento a ser compactado */
+    RegistoDiario* pendentes;                  /**< Registos do grupo ainda nao escritos */
+    int num_pendentes;                         /**< Numero de registos pendentes */
+    int cap_pendentes;                         /**< Capacidade alocada em pendentes (cresce se a escrita falhar) */
+    int registos_por_grupo;                    /**< Tamanho de cada grupo escrito de uma so vez */
+    int registos_no_segmento;                  /**< Registos ja escritos no segmento atual */
+    int limite_compactacao;                    /**< Registos no segmento a partir dos quais se compacta */
+    void* compactacao;                         /**< HANDLE da thread de compactacao (NULL se nao existir) */
+} Diario;
+
+
+Diario* abrir_diario(Grafo* grafo, const char* nome_base, int registos_por_grupo, int limite_compactacao);
+bool fechar_diario(Diario* diario);
+bool diario_registar(Diario* diario, int tipo, int a, int b, int c);
+bool diario_confirmar(Diario* diario);
+bool diario_compactar(Diario* diario);
+Grafo* carregar_grafo_diario(const char* nome_base);
+#endif /* DIARIO_H */
@@ -0,0 +1,606 @@
+﻿/*******************************************************************************************************************
+* @file distancias.c
+* @brief Manutencao incremental de arvores BFS para um conjunto fixo de vertices de origem
+** @autor Diogo Oliveira (a20468@alunos.ipca.pt)
+* Este ficheiro contém a implementação das seguintes funcionalidades:
+* - Criação e destruição das arvores BFS associadas a um grafo
+* - Onda de relaxacao local apos a insercao de uma aresta
+* - Reparacao limitada a subarvore afetada apos a remocao de uma aresta
+* - Consulta de distancias e caminhos em tempo proporcional ao tamanho do caminho
+* @date maio 2024
+*
+* @copyright Copyright (c) 2024
+*
+*******************************************************************************************************************/
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "grafo.h"
+#include "bfs.h"
+#include "distancias.h"
+
+
+#pragma region Funcoes Auxiliares
+/**
+ * @brief Procura a arvore associada a um vertice de origem
+ *
+ * @return Indice da arvore, ou -1 se a origem nao for mantida
+ */
+static int procurar_arvore(Distancias* distancias, int origem) {
+    if (origem < 0) {
+        return -1;
+    }
+    for (int i = 0; i < distancias->num_arvores; ++i) {
+        if (distancias->arvores[i].origem == origem) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Realoca um array para n elementos (pelo menos 1, para evitar realloc de 0 bytes)
+ */
+static bool ajustar_array(void** array, int n, size_t tamanho) {
+    void* novo = realloc(*array, (n > 0 ? n : 1) * tamanho);
+    if (novo == NULL) {
+        return false;
+    }
+    *array = novo;
+    return true;
+}
+
+/**
+ * @brief Redimensiona todos os arrays por vertice, inicializando as novas posicoes
+ */
+static bool redimensionar(Distancias* distancias, int n) {
+    // Libertar as listas de entrada dos vertices que deixaram de existir
+    for (int i = n; i < distancias->num_vertices; ++i) {
+        free(distancias->entradas[i]);
+        distancias->entradas[i] = NULL;
+        distancias->num_entradas[i] = 0;
+        distancias->cap_entradas[i] = 0;
+    }
+    if (n < distancias->num_vertices) {
+        distancias->num_vertices = n;
+    }
+
+    if (!ajustar_array((void**)&distancias->entradas, n, sizeof(int*)) ||
+        !ajustar_array((void**)&distancias->num_entradas, n, sizeof(int)) ||
+        !ajustar_array((void**)&distancias->cap_entradas, n, sizeof(int)) ||
+        !ajustar_array((void**)&distancias->afetado, n, sizeof(bool)) ||
+        !ajustar_array((void**)&distancias->em_fila, n, sizeof(bool)) ||
+        !ajustar_array((void**)&distancias->subarvore, n, sizeof(int))) {
+        return false;
+    }
+    for (int t = 0; t < distancias->num_arvores; ++t) {
+        if (!ajustar_array((void**)&distancias->arvores[t].distancia, n, sizeof(int)) ||
+            !ajustar_array((void**)&distancias->arvores[t].predecessor, n, sizeof(int))) {
+            return false;
+        }
+    }
+
+    // A fila tem sempre capacidade para todos os vertices, para que enfileirar nunca precise de
+    // aumentar (nem falhar) durante uma pesquisa; entre pesquisas esta vazia e pode ser trocada
+    if (distancias->fila == NULL || distancias->fila->capacidade < (unsigned)n) {
+        Fila* fila = criar_fila((unsigned)n);
+        if (fila == NULL) {
+            return false;
+        }
+        destruir_fila(distancias->fila);
+        distancias->fila = fila;
+    }
+
+    for (int i = distancias->num_vertices; i < n; ++i) {
+        distancias->entradas[i] = NULL;
+        distancias->num_entradas[i] = 0;
+        distancias->cap_entradas[i] = 0;
+        distancias->afetado[i] = false;
+        distancias->em_fila[i] = false;
+        for (int t = 0; t < distancias->num_arvores; ++t) {
+            distancias->arvores[t].distancia[i] = DISTANCIA_INFINITA;
+            distancias->arvores[t].predecessor[i] = -1;
+        }
+    }
+    distancias->num_vertices = n;
+    return true;
+}
+
+/**
+ * @brief Regista que existe uma aresta de origem para destino
+ */
+static bool adicionar_entrada(Distancias* distancias, int destino, int origem) {
+    if (distancias->num_entradas[destino] == distancias->cap_entradas[destino]) {
+        int nova_cap = distancias->cap_entradas[destino] > 0 ? 2 * distancias->cap_entradas[destino] : 4;
+        int* nova_lista = realloc(distancias->entradas[destino], nova_cap * sizeof(int));
+        if (nova_lista == NULL) {
+            return false;
+        }
+        distancias->entradas[destino] = nova_lista;
+        distancias->cap_entradas[destino] = nova_cap;
+    }
+    distancias->entradas[destino][distancias->num_entradas[destino]++] = origem;
+    return true;
+}
+
+/**
+ * @brief Remove uma ocorrencia da aresta de origem para destino das listas de entrada
+ */
+static void remover_entrada(Distancias* distancias, int destino, int origem) {
+    int* lista = distancias->entradas[destino];
+    for (int i = 0; i < distancias->num_entradas[destino]; ++i) {
+        if (lista[i] == origem) {
+            lista[i] = lista[--distancias->num_entradas[destino]];
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Verifica se ainda existe alguma aresta de origem para destino
+ */
+static bool existe_aresta(Grafo* grafo, int origem, int destino) {
+    Aresta* aresta_atual = grafo->lista_adj[origem]->lista_arestas;
+    while (aresta_atual) {
+        if (aresta_atual->destino == destino) {
+            return true;
+        }
+        aresta_atual = aresta_atual->prox;
+    }
+    return false;
+}
+
+/**
+ * @brief Calcula a arvore BFS completa a partir da origem
+ */
+static void calcular_arvore(Distancias* distancias, ArvoreBFS* arvore) {
+    int n = distancias->num_vertices;
+    int* distancia = arvore->distancia;
+    int* predecessor = arvore->predecessor;
+    for (int i = 0; i < n; ++i) {
+        distancia[i] = DISTANCIA_INFINITA;
+        predecessor[i] = -1;
+    }
+    if (arvore->origem < 0 || arvore->origem >= n) {
+        return;
+    }
+
+    Fila* fila = distancias->fila;
+    distancia[arvore->origem] = 0;
+    // Nunca falha: a fila tem capacidade num_vertices e cada vertice entra no maximo uma vez
+    enfileirar(fila, arvore->origem);
+    while (!fila_vazia(fila)) {
+        int vertice_atual = desenfileirar(fila);
+        Aresta* aresta_atual = distancias->grafo->lista_adj[vertice_atual]->lista_arestas;
+        while (aresta_atual) {
+            int vertice_vizinho = aresta_atual->destino;
+            if (vertice_vizinho < n && distancia[vertice_vizinho] == DISTANCIA_INFINITA) {
+                distancia[vertice_vizinho] = distancia[vertice_atual] + 1;
+                predecessor[vertice_vizinho] = vertice_atual;
+                // Nunca falha: so vertices ainda inalcancaveis entram na fila
+                enfileirar(fila, vertice_vizinho);
+            }
+            aresta_atual = aresta_atual->prox;
+        }
+    }
+}
+
+/**
+ * @brief Propaga a melhoria causada pela nova aresta origem -> destino
+ *
+ * Apenas os vertices cuja distancia diminui sao visitados. Como todos os caminhos melhorados
+ * passam pela nova aresta e a onda avanca por niveis, cada vertice entra na fila no maximo uma vez.
+ */
+static void relaxar(Distancias* distancias, ArvoreBFS* arvore, int origem, int destino) {
+    int* distancia = arvore->distancia;
+    int* predecessor = arvore->predecessor;
+    if (distancia[origem] == DISTANCIA_INFINITA) {
+        return;
+    }
+    if (distancia[destino] != DISTANCIA_INFINITA && distancia[destino] <= distancia[origem] + 1) {
+        return;
+    }
+
+    Fila* fila = distancias->fila;
+    distancia[destino] = distancia[origem] + 1;
+    predecessor[destino] = origem;
+    // Nunca falha: a fila tem capacidade num_vertices e cada vertice entra no maximo uma vez
+    enfileirar(fila, destino);
+    while (!fila_vazia(fila)) {
+        int vertice_atual = desenfileirar(fila);
+        Aresta* aresta_atual = distancias->grafo->lista_adj[vertice_atual]->lista_arestas;
+        while (aresta_atual) {
+            int vertice_vizinho = aresta_atual->destino;
+            if (vertice_vizinho < distancias->num_vertices &&
+                (distancia[vertice_vizinho] == DISTANCIA_INFINITA ||
+                    distancia[vertice_vizinho] > distancia[vertice_atual] + 1)) {
+                distancia[vertice_vizinho] = distancia[vertice_atual] + 1;
+                predecessor[vertice_vizinho] = vertice_atual;
+                // Nunca falha: cada vertice entra no maximo uma vez (ver acima)
+                enfileirar(fila, vertice_vizinho);
+            }
+            aresta_atual = aresta_atual->prox;
+        }
+    }
+}
+
+/**
+ * @brief Repara a arvore depois de a aresta que ligava raiz ao seu predecessor ter sido removida
+ *
+ * Apenas a subarvore de raiz e invalidada e pesquisada de novo; os restantes vertices mantem a distancia.
+ */
+static void reparar(Distancias* distancias, ArvoreBFS* arvore, int raiz) {
+    int* distancia = arvore->distancia;
+    int* predecessor = arvore->predecessor;
+    int* subarvore = distancias->subarvore;
+    bool* afetado = distancias->afetado;
+    bool* em_fila = distancias->em_fila;
+    Fila* fila = distancias->fila;
+    int n = distancias->num_vertices;
+
+    // Recolher os descendentes de raiz na arvore BFS
+    int tamanho = 0;
+    subarvore[tamanho++] = raiz;
+    afetado[raiz] = true;
+    for (int i = 0; i < tamanho; ++i) {
+        int vertice_atual = subarvore[i];
+        Aresta* aresta_atual = distancias->grafo->lista_adj[vertice_atual]->lista_arestas;
+        while (aresta_atual) {
+            int vertice_vizinho = aresta_atual->destino;
+            if (vertice_vizinho < n && !afetado[vertice_vizinho] && predecessor[vertice_vizinho] == vertice_atual) {
+                afetado[vertice_vizinho] = true;
+                subarvore[tamanho++] = vertice_vizinho;
+            }
+            aresta_atual = aresta_atual->prox;
+        }
+    }
+    for (int i = 0; i < tamanho; ++i) {
+        distancia[subarvore[i]] = DISTANCIA_INFINITA;
+        predecessor[subarvore[i]] = -1;
+    }
+
+    // Cada vertice afetado recebe a melhor distancia oferecida por vizinhos nao afetados
+    for (int i = 0; i < tamanho; ++i) {
+        int vertice = subarvore[i];
+        for (int j = 0; j < distancias->num_entradas[vertice]; ++j) {
+            int vizinho = distancias->entradas[vertice][j];
+            if (!afetado[vizinho] && distancia[vizinho] != DISTANCIA_INFINITA &&
+                (distancia[vertice] == DISTANCIA_INFINITA || distancia[vizinho] + 1 < distancia[vertice])) {
+                distancia[vertice] = distancia[vizinho] + 1;
+                predecessor[vertice] = vizinho;
+            }
+        }
+        if (distancia[vertice] != DISTANCIA_INFINITA) {
+            // Nunca falha: a fila tem capacidade num_vertices e em_fila impede repeticoes
+            enfileirar(fila, vertice);
+            em_fila[vertice] = true;
+        }
+    }
+
+    // Propagar dentro da subarvore ate as distancias estabilizarem
+    while (!fila_vazia(fila)) {
+        int vertice_atual = desenfileirar(fila);
+        em_fila[vertice_atual] = false;
+        Aresta* aresta_atual = distancias->grafo->lista_adj[vertice_atual]->lista_arestas;
+        while (aresta_atual) {
+            int vertice_vizinho = aresta_atual->destino;
+            if (vertice_vizinho < n && afetado[vertice_vizinho] &&
+                (distancia[vertice_vizinho] == DISTANCIA_INFINITA ||
+                    distancia[vertice_atual] + 1 < distancia[vertice_vizinho])) {
+                distancia[vertice_vizinho] = distancia[vertice_atual] + 1;
+                predecessor[vertice_vizinho] = vertice_atual;
+                if (!em_fila[vertice_vizinho]) {
+                    // Nunca falha: em_fila impede que um vertice esteja duas vezes na fila
+                    enfileirar(fila, vertice_vizinho);
+                    em_fila[vertice_vizinho] = true;
+                }
+            }
+            aresta_atual = aresta_atual->prox;
+        }
+    }
+
+    for (int i = 0; i < tamanho; ++i) {
+        afetado[subarvore[i]] = false;
+    }
+}
+#pragma endregion
+
+
+#pragma region Criar Distancias
+/**
+ * @brief Cria as arvores BFS para os vertices de origem e associa-as ao grafo
+ *
+ * A partir deste momento adicionar_aresta, remover_aresta, adicionar_vertice e remover_vertice
+ * mantem as arvores atualizadas automaticamente.
+ *
+ * @param grafo Ponteiro para o grafo
+ * @param origens Indices dos vertices de origem a manter (todos em [0, num_vertices))
+ * @param num_origens Numero de vertices de origem
+ * @return Ponteiro para a estrutura criada, ou NULL em caso de erro ou de origem invalida
+ *
+ * @autor Diogo Oliveira
+ */
+Distancias* criar_distancias(Grafo* grafo, const int* origens, int num_origens) {
+    if (grafo == NULL || grafo->distancias != NULL || origens == NULL || num_origens <= 0) {
+        return NULL;
+    }
+    for (int i = 0; i < num_origens; ++i) {
+        if (origens[i] < 0 || origens[i] >= grafo->num_vertices) {
+            return NULL;
+        }
+    }
+    Distancias* distancias = (Distancias*)calloc(1, sizeof(Distancias));
+    if (distancias == NULL) {
+        return NULL;
+    }
+    distancias->grafo = grafo;
+    distancias->arvores = (ArvoreBFS*)calloc(num_origens, sizeof(ArvoreBFS));
+    if (distancias->arvores == NULL) {
+        free(distancias);
+        return NULL;
+    }
+    distancias->num_arvores = num_origens;
+    for (int i = 0; i < num_origens; ++i) {
+        distancias->arvores[i].origem = origens[i];
+    }
+    grafo->distancias = distancias;
+
+    if (!distancias_reconstruir(distancias)) {
+        destruir_distancias(distancias);
+        return NULL;
+    }
+    return distancias;
+}
+#pragma endregion
+
+
+#pragma region Destruir Distancias
+/**
+ * @brief Destroi as arvores BFS e desassocia-as do grafo
+ *
+ * @param distancias Ponteiro para a estrutura a destruir
+ * @return true se foi destruida com sucesso, false caso contrario
+ *
+ * @autor Diogo Oliveira
+ */
+bool destruir_distancias(Distancias* distancias) {
+    if (distancias == NULL) {
+        return false;
+    }
+    if (distancias->grafo != NULL && distancias->grafo->distancias == distancias) {
+        distancias->grafo->distancias = NULL;
+    }
+    for (int i = 0; i < distancias->num_arvores; ++i) {
+        free(distancias->arvores[i].distancia);
+        free(distancias->arvores[i].predecessor);
+    }
+    for (int i = 0; i < distancias->num_vertices; ++i) {
+        free(distancias->entradas[i]);
+    }
+    destruir_fila(distancias->fila);
+    free(distancias->arvores);
+    free(distancias->entradas);
+    free(distancias->num_entradas);
+    free(distancias->cap_entradas);
+    free(distancias->afetado);
+    free(distancias->em_fila);
+    free(distancias->subarvore);
+    free(distancias);
+    return true;
+}
+#pragma endregion
+
+
+#pragma region Reconstruir Distancias
+/**
+ * @brief Recalcula todas as arvores a partir do zero
+ *
+ * Usado na criacao, depois de remover_vertice, que desloca os indices dos vertices, e sempre que
+ * uma atualizacao incremental falha. Se falhar, as arvores ficam marcadas como desatualizadas e a
+ * reconstrucao e repetida na proxima consulta.
+ *
+ * @param distancias Ponteiro para a estrutura
+ * @return true se foi reconstruida com sucesso, false caso contrario
+ *
+ * @autor Diogo Oliveira
+ */
+bool distancias_reconstruir(Distancias* distancias) {
+    if (distancias == NULL) {
+        return false;
+    }
+    Grafo* grafo = distancias->grafo;
+    distancias->desatualizada = true;
+    if (!redimensionar(distancias, grafo->num_vertices)) {
+        return false;
+    }
+    int n = distancias->num_vertices;
+    for (int i = 0; i < n; ++i) {
+        distancias->num_entradas[i] = 0;
+    }
+    for (int i = 0; i < n; ++i) {
+        Aresta* aresta_atual = grafo->lista_adj[i]->lista_arestas;
+        while (aresta_atual) {
+            if (aresta_atual->destino < n && !adicionar_entrada(distancias, aresta_atual->destino, i)) {
+                return false;
+            }
+            aresta_atual = aresta_atual->prox;
+        }
+    }
+    for (int t = 0; t < distancias->num_arvores; ++t) {
+        calcular_arvore(distancias, &distancias->arvores[t]);
+    }
+    distancias->desatualizada = false;
+    return true;
+}
+#pragma endregion
+
+
+#pragma region Vertice Adicionado
+/**
+ * @brief Acompanha a adicao de um vertice ao grafo (o novo vertice fica inalcancavel)
+ *
+ * @param distancias Ponteiro para a estrutura (pode ser NULL)
+ * @return true se foi atualizada com sucesso, false caso contrario
+ *
+ * @autor Diogo Oliveira
+ */
+bool distancias_vertice_adicionado(Distancias* distancias) {
+    if (distancias == NULL) {
+        return false;
+    }
+    return redimensionar(distancias, distancias->grafo->num_vertices);
+}
+#pragma endregion
+
+
+#pragma region Vertice Removido
+/**
+ * @brief Acompanha a remocao do vertice com o indice dado e a renumeracao dos seguintes
+ *
+ * As origens com indice superior sao decrementadas, tal como no grafo. A arvore cuja origem foi
+ * removida deixa de ser mantida (origem -1) e todas as consultas a partir dela devolvem
+ * DISTANCIA_INFINITA. Como os indices mudaram, as arvores sao depois reconstruidas.
+ *
+ * @param distancias Ponteiro para a estrutura (pode ser NULL)
+ * @param indice Indice que o vertice removido ocupava
+ * @return true se foi atualizada com sucesso, false caso contrario
+ *
+ * @autor Diogo Oliveira
+ */
+bool distancias_vertice_removido(Distancias* distancias, int indice) {
+    if (distancias == NULL || indice < 0) {
+        return false;
+    }
+    for (int t = 0; t < distancias->num_arvores; ++t) {
+        ArvoreBFS* arvore = &distancias->arvores[t];
+        if (arvore->origem == indice) {
+            arvore->origem = -1;
+        }
+        else if (arvore->origem > indice) {
+            arvore->origem--;
+        }
+    }
+    return distancias_reconstruir(distancias);
+}
+#pragma endregion
+
+
+#pragma region Aresta Adicionada
+/**
+ * @brief Atualiza as arvores depois da insercao da aresta origem -> destino
+ *
+ * @param distancias Ponteiro para a estrutura (pode ser NULL)
+ * @param origem Indice do vertice de origem da aresta
+ * @param destino Indice do vertice de destino da aresta
+ * @return true se foi atualizada com sucesso, false caso contrario
+ *
+ * @autor Diogo Oliveira
+ */
+bool distancias_aresta_adicionada(Distancias* distancias, int origem, int destino) {
+    if (distancias == NULL || origem < 0 || destino < 0 ||
+        origem >= distancias->num_vertices || destino >= distancias->num_vertices) {
+        return false;
+    }
+    if (!adicionar_entrada(distancias, destino, origem)) {
+        return false;
+    }
+    for (int t = 0; t < distancias->num_arvores; ++t) {
+        relaxar(distancias, &distancias->arvores[t], origem, destino);
+    }
+    return true;
+}
+#pragma endregion
+
+
+#pragma region Aresta Removida
+/**
+ * @brief Atualiza as arvores depois da remocao da aresta origem -> destino
+ *
+ * So as arvores em que a aresta removida era a ligacao de destino ao seu predecessor sao reparadas.
+ *
+ * @param distancias Ponteiro para a estrutura (pode ser NULL)
+ * @param origem Indice do vertice de origem da aresta
+ * @param destino Indice do vertice de destino da aresta
+ * @return true se foi atualizada com sucesso, false caso contrario
+ *
+ * @autor Diogo Oliveira
+ */
+bool distancias_aresta_removida(Distancias* distancias, int origem, int destino) {
+    if (distancias == NULL || origem < 0 || destino < 0 ||
+        origem >= distancias->num_vertices || destino >= distancias->num_vertices) {
+        return false;
+    }
+    remover_entrada(distancias, destino, origem);
+    if (existe_aresta(distancias->grafo, origem, destino)) {
+        return true;
+    }
+    for (int t = 0; t < distancias->num_arvores; ++t) {
+        if (distancias->arvores[t].predecessor[destino] == origem) {
+            reparar(distancias, &distancias->arvores[t], destino);
+        }
+    }
+    return true;
+}
+#pragma endregion
+
+
+#pragma region Consultar Distancia
+/**
+ * @brief Devolve o numero de arestas do caminho mais curto entre origem e destino
+ *
+ * @param distancias Ponteiro para a estrutura
+ * @param origem Indice de um dos vertices de origem mantidos
+ * @param destino Indice do vertice de destino
+ * @return A distancia, ou DISTANCIA_INFINITA se nao existir caminho, a origem nao for mantida ou
+ *         as arvores desatualizadas nao puderem ser reconstruidas
+ *
+ * @autor Diogo Oliveira
+ */
+int distancias_consultar(Distancias* distancias, int origem, int destino) {
+    if (distancias == NULL) {
+        return DISTANCIA_INFINITA;
+    }
+    if (distancias->desatualizada && !distancias_reconstruir(distancias)) {
+        return DISTANCIA_INFINITA;
+    }
+    if (destino < 0 || destino >= distancias->num_vertices) {
+        return DISTANCIA_INFINITA;
+    }
+    int t = procurar_arvore(distancias, origem);
+    if (t < 0) {
+        return DISTANCIA_INFINITA;
+    }
+    return distancias->arvores[t].distancia[destino];
+}
+#pragma endregion
+
+
+#pragma region Consultar Caminho
+/**
+ * @brief Escreve o caminho mais curto entre origem e destino, em tempo proporcional ao seu tamanho
+ *
+ * @param distancias Ponteiro para a estrutura
+ * @param origem Indice de um dos vertices de origem mantidos
+ * @param destino Indice do vertice de destino
+ * @param caminho Array onde sao escritos os vertices do caminho, de origem para destino
+ * @param capacidade Tamanho do array caminho
+ * @return Numero de vertices do caminho, ou -1 se nao existir caminho ou nao couber no array
+ *
+ * @autor Diogo Oliveira
+ */
+int distancias_caminho(Distancias* distancias, int origem, int destino, int* caminho, int capacidade) {
+    int distancia = distancias_consultar(distancias, origem, destino);
+    if (distancia == DISTANCIA_INFINITA || caminho == NULL || distancia + 1 > capacidade) {
+        return -1;
+    }
+    int* predecessor = distancias->arvores[procurar_arvore(distancias, origem)].predecessor;
+    int atual = destino;
+    for (int i = distancia; i >= 0; --i) {
+        caminho[i] = atual;
+        atual = predecessor[atual];
+    }
+    return distancia + 1;
+}
+#pragma endregion
@@ -0,0 +1,62 @@
+﻿/*******************************************************************************************************************
+* @file distancias.h
+* @author Diogo Oliveira (a20468@alunos.ipca.pt)
+* @brief header responsável pela definiçao das arvores BFS mantidas incrementalmente
+* @date maio 2024 *
+*
+* @copyright Copyright (c) 2024
+*
+*******************************************************************************************************************/
+
+
+#ifndef DISTANCIAS_H
+#define DISTANCIAS_H
+
+#include <stdbool.h>
+#include "grafo.h"
+#include "bfs.h"
+
+#define DISTANCIA_INFINITA -1
+
+/**
+ * @brief Arvore BFS (distancias e predecessores) a partir de um vertice de origem
+ *
+ * @autor Diogo Oliveira
+ */
+typedef struct ArvoreBFS {
+    int origem;        /**< Indice do vertice de origem da arvore */
+    int* distancia;    /**< Numero de arestas ate cada vertice (DISTANCIA_INFINITA se inalcancavel) */
+    int* predecessor;  /**< Predecessor de cada vertice na arvore (-1 se nao existir) */
+} ArvoreBFS;
+
+/**
+ * @brief Conjunto de arvores BFS atualizadas a cada alteracao das arestas do grafo
+ *
+ * @autor Diogo Oliveira
+ */
+typedef struct Distancias {
+    Grafo* grafo;         /**< Grafo ao qual as arvores estao associadas */
+    int num_vertices;     /**< Numero de vertices para o qual os arrays estao dimensionados */
+    int num_arvores;      /**< Numero de vertices de origem mantidos */
+    ArvoreBFS* arvores;   /**< Uma arvore por vertice de origem */
+    int** entradas;       /**< Para cada vertice, origens das arestas que chegam a ele */
+    int* num_entradas;    /**< Numero de arestas de entrada de cada vertice */
+    int* cap_entradas;    /**< Capacidade alocada em cada lista de entradas */
+    bool* afetado;        /**< Marcas temporarias usadas na reparacao apos remocoes */
+    bool* em_fila;        /**< Marcas temporarias usadas nas ondas de relaxacao */
+    int* subarvore;       /**< Vertices da subarvore afetada por uma remocao */
+    Fila* fila;           /**< Fila reutilizada em todas as pesquisas, com capacidade num_vertices */
+    bool desatualizada;   /**< Uma atualizacao falhou e as arvores sao reconstruidas na proxima consulta */
+} Distancias;
+
+
+Distancias* criar_distancias(Grafo* grafo, const int* origens, int num_origens);
+bool destruir_distancias(Distancias* distancias);
+bool distancias_reconstruir(Distancias* distancias);
+bool distancias_vertice_adicionado(Distancias* distancias);
+bool distancias_vertice_removido(Distancias* distancias, int indice);
+bool distancias_aresta_adicionada(Distancias* distancias, int origem, int destino);
+bool distancias_aresta_removida(Distancias* distancias, int origem, int destino);
+int distancias_consultar(Distancias* distancias, int origem, int destino);
+int distancias_caminho(Distancias* distancias, int origem, int destino, int* caminho, int capacidade);
+#endif /* DISTANCIAS_H */
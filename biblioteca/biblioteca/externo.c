@@ -0,0 +1,504 @@
+﻿/*******************************************************************************************************************
+* @file externo.c
+* @brief Pesquisa em largura sobre um grafo particionado em disco
+** @autor Diogo Oliveira (a20468@alunos.ipca.pt)
+* Este ficheiro contém a implementação das seguintes funcionalidades:
+* - Divisão do ficheiro de guardar_grafo_binario em particoes por intervalos de vertices
+* - Abertura e fecho do grafo particionado
+* - BFS por niveis que mantem em memoria apenas os bitmaps de fronteira e de visitados,
+*   lendo as particoes sequencialmente com leitura antecipada numa thread auxiliar
+* @date maio 2024
+*
+* @copyright Copyright (c) 2024
+*
+*******************************************************************************************************************/
+
+
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "bfs.h"
+#include "externo.h"
+
+#define EXTERNO_BUFFER_LEITURA 65536 /**< Inteiros lidos de cada vez do ficheiro de origem */
+
+/**
+ * @brief Leitor de inteiros com buffer, para nao fazer um fread por inteiro
+ */
+typedef struct LeitorInteiros {
+    FILE* ficheiro;
+    int* buffer;
+    size_t quantidade;
+    size_t posicao;
+} LeitorInteiros;
+
+/**
+ * @brief Arestas de uma particao carregadas em memoria
+ */
+typedef struct Particao {
+    int primeiro;      /**< Primeiro vertice da particao */
+    int num_vertices;  /**< Numero de vertices da particao */
+    int num_arestas;   /**< Numero de arestas da particao */
+    int* inicio;       /**< Indice (relativo) da primeira aresta de cada vertice */
+    int* destino;      /**< Destino de cada aresta */
+    int cap_inicio;    /**< Capacidade alocada em inicio */
+    int cap_destino;   /**< Capacidade alocada em destino */
+} Particao;
+
+/**
+ * @brief Estado partilhado entre a BFS e a thread de leitura antecipada
+ *
+ * Uma unica thread de leitura serve toda a travessia: em cada nivel a BFS poe na fila de pedidos
+ * as particoes a ler, e a thread enche alternadamente dois buffers com elas, enquanto a BFS
+ * processa o outro.
+ */
+typedef struct LeituraAntecipada {
+    GrafoExterno* externo;
+    FilaConcorrente* pedidos;   /**< Particoes a ler, por ordem (a BFS produz, a thread consome) */
+    Particao buffers[2];        /**< Buffers duplos */
+    bool pronto[2];             /**< Indica se o buffer contem uma particao por processar */
+    bool erro;                  /**< Indica que uma leitura falhou */
+    bool terminar;              /**< Indica que a BFS terminou e a thread deve sair */
+    SRWLOCK trinco;
+    CONDITION_VARIABLE mudou;
+} LeituraAntecipada;
+
+
+#pragma region Funcoes Auxiliares
+/**
+ * @brief Le o proximo inteiro do ficheiro
+ */
+static bool ler_inteiro(LeitorInteiros* leitor, int* valor) {
+    if (leitor->posicao == leitor->quantidade) {
+        leitor->quantidade = fread(leitor->buffer, sizeof(int), EXTERNO_BUFFER_LEITURA, leitor->ficheiro);
+        leitor->posicao = 0;
+        if (leitor->quantidade == 0) {
+            return false;
+        }
+    }
+    *valor = leitor->buffer[leitor->posicao++];
+    return true;
+}
+
+/**
+ * @brief Garante que um array de inteiros tem pelo menos a capacidade pedida
+ */
+static bool garantir_capacidade(int** array, int* capacidade, int necessaria) {
+    if (necessaria <= *capacidade) {
+        return true;
+    }
+    int nova_capacidade = *capacidade > 0 ? *capacidade : 64;
+    while (nova_capacidade < necessaria) {
+        nova_capacidade *= 2;
+    }
+    int* novo = (int*)realloc(*array, nova_capacidade * sizeof(int));
+    if (novo == NULL) {
+        return false;
+    }
+    *array = novo;
+    *capacidade = nova_capacidade;
+    return true;
+}
+
+/**
+ * @brief Escreve uma particao em <prefixo>.<p>.part
+ */
+static bool escrever_particao(const char* prefixo, int indice, Particao* particao) {
+    char nome[EXTERNO_MAX_NOME + 32];
+    snprintf(nome, sizeof(nome), "%s.%d.part", prefixo, indice);
+    FILE* ficheiro = fopen(nome, "wb");
+    if (!ficheiro) {
+        return false;
+    }
+    bool sucesso = fwrite(&particao->primeiro, sizeof(int), 1, ficheiro) == 1 &&
+        fwrite(&particao->num_vertices, sizeof(int), 1, ficheiro) == 1 &&
+        fwrite(&particao->num_arestas, sizeof(int), 1, ficheiro) == 1 &&
+        fwrite(particao->inicio, sizeof(int), particao->num_vertices + 1, ficheiro) == (size_t)particao->num_vertices + 1 &&
+        fwrite(particao->destino, sizeof(int), particao->num_arestas, ficheiro) == (size_t)particao->num_arestas;
+    return fclose(ficheiro) == 0 && sucesso;
+}
+
+/**
+ * @brief Verifica se uma particao lida do disco e coerente com os metadados do grafo
+ *
+ * A particao tem de comecar em p * vertices_por_particao e cobrir exatamente os seus vertices,
+ * os indices inicio tem de ser crescentes e dentro do array de destinos, e todos os destinos tem
+ * de ser vertices existentes, para que a BFS nunca escreva fora dos bitmaps.
+ */
+static bool particao_valida(GrafoExterno* externo, int indice, Particao* particao) {
+    long long primeiro = (long long)indice * externo->vertices_por_particao;
+    long long esperados = externo->num_vertices - primeiro;
+    if (esperados > externo->vertices_por_particao) {
+        esperados = externo->vertices_por_particao;
+    }
+    if (particao->primeiro != primeiro || particao->num_vertices != esperados ||
+        particao->inicio[0] != 0 || particao->inicio[particao->num_vertices] != particao->num_arestas) {
+        return false;
+    }
+    for (int j = 0; j < particao->num_vertices; ++j) {
+        if (particao->inicio[j] > particao->inicio[j + 1]) {
+            return false;
+        }
+    }
+    for (int k = 0; k < particao->num_arestas; ++k) {
+        if (particao->destino[k] < 0 || particao->destino[k] >= externo->num_vertices) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Le a particao p do disco para o buffer indicado, reaproveitando a memoria ja alocada
+ */
+static bool ler_particao(GrafoExterno* externo, int indice, Particao* particao) {
+    char nome[EXTERNO_MAX_NOME + 32];
+    snprintf(nome, sizeof(nome), "%s.%d.part", externo->prefixo, indice);
+    FILE* ficheiro = fopen(nome, "rb");
+    if (!ficheiro) {
+        return false;
+    }
+    bool sucesso = fread(&particao->primeiro, sizeof(int), 1, ficheiro) == 1 &&
+        fread(&particao->num_vertices, sizeof(int), 1, ficheiro) == 1 &&
+        fread(&particao->num_arestas, sizeof(int), 1, ficheiro) == 1 &&
+        particao->num_vertices >= 0 && particao->num_arestas >= 0 &&
+        garantir_capacidade(&particao->inicio, &particao->cap_inicio, particao->num_vertices + 1) &&
+        garantir_capacidade(&particao->destino, &particao->cap_destino, particao->num_arestas) &&
+        fread(particao->inicio, sizeof(int), particao->num_vertices + 1, ficheiro) == (size_t)particao->num_vertices + 1 &&
+        fread(particao->destino, sizeof(int), particao->num_arestas, ficheiro) == (size_t)particao->num_arestas;
+    fclose(ficheiro);
+    return sucesso && particao_valida(externo, indice, particao);
+}
+
+/**
+ * @brief Thread de leitura antecipada: le as particoes pedidas para os buffers livres
+ *
+ * Espera por um pedido e por o proximo buffer estar livre; termina quando a BFS marca terminar.
+ * Depois de um erro continua a marcar os buffers como prontos, sem ler, para a BFS nao bloquear.
+ */
+static DWORD WINAPI ler_antecipadamente(LPVOID parametro) {
+    LeituraAntecipada* leitura = (LeituraAntecipada*)parametro;
+    bool erro = false;
+    for (unsigned int i = 0; ; ++i) {
+        int slot = (int)(i % 2);
+        int pedido = -1;
+        bool obtido = false;
+        AcquireSRWLockExclusive(&leitura->trinco);
+        while (!leitura->terminar && !obtido) {
+            if (!leitura->pronto[slot] && fila_concorrente_desenfileirar(leitura->pedidos, &pedido)) {
+                obtido = true;
+            }
+            else {
+                SleepConditionVariableSRW(&leitura->mudou, &leitura->trinco, INFINITE, 0);
+            }
+        }
+        ReleaseSRWLockExclusive(&leitura->trinco);
+        if (!obtido) {
+            return 0;
+        }
+
+        erro = erro || !ler_particao(leitura->externo, pedido, &leitura->buffers[slot]);
+
+        AcquireSRWLockExclusive(&leitura->trinco);
+        leitura->erro = erro;
+        leitura->pronto[slot] = true;
+        ReleaseSRWLockExclusive(&leitura->trinco);
+        WakeAllConditionVariable(&leitura->mudou);
+    }
+}
+
+/**
+ * @brief Testa o bit v de um bitmap
+ */
+static bool bit_ativo(const uint64_t* bitmap, int v) {
+    return (bitmap[v >> 6] >> (v & 63)) & 1;
+}
+
+/**
+ * @brief Ativa o bit v de um bitmap
+ */
+static void ativar_bit(uint64_t* bitmap, int v) {
+    bitmap[v >> 6] |= (uint64_t)1 << (v & 63);
+}
+#pragma endregion
+
+
+#pragma region Particionar Grafo Binario
+/**
+ * @brief Divide o ficheiro escrito por guardar_grafo_binario em particoes por intervalos de vertices
+ *
+ * O ficheiro e lido sequencialmente e so uma particao de cada vez e mantida em memoria.
+ *
+ * @param nome_ficheiro Ficheiro produzido por guardar_grafo_binario
+ * @param prefixo Prefixo dos ficheiros a criar (<prefixo>.meta e <prefixo>.<p>.part)
+ * @param vertices_por_particao Numero de vertices em cada particao
+ * @return true se o grafo foi particionado com sucesso, false caso contrario
+ *
+ * @autor Diogo Oliveira
+ */
+bool particionar_grafo_binario(const char* nome_ficheiro, const char* prefixo, int vertices_por_particao) {
+    if (nome_ficheiro == NULL || prefixo == NULL || vertices_por_particao <= 0 ||
+        strlen(prefixo) >= EXTERNO_MAX_NOME) {
+        return false;
+    }
+    LeitorInteiros leitor = { fopen(nome_ficheiro, "rb"), NULL, 0, 0 };
+    if (!leitor.ficheiro) {
+        return false;
+    }
+    leitor.buffer = (int*)malloc(EXTERNO_BUFFER_LEITURA * sizeof(int));
+    Particao particao = { 0 };
+    int num_vertices = 0;
+    bool sucesso = leitor.buffer != NULL && ler_inteiro(&leitor, &num_vertices) && num_vertices >= 0;
+    int num_particoes = sucesso ? (int)(((long long)num_vertices + vertices_por_particao - 1) / vertices_por_particao) : 0;
+
+    for (int p = 0; sucesso && p < num_particoes; ++p) {
+        particao.primeiro = p * vertices_por_particao;
+        particao.num_vertices = num_vertices - particao.primeiro < vertices_por_particao ?
+            num_vertices - particao.primeiro : vertices_por_particao;
+        particao.num_arestas = 0;
+        sucesso = garantir_capacidade(&particao.inicio, &particao.cap_inicio, particao.num_vertices + 1);
+
+        for (int i = 0; sucesso && i < particao.num_vertices; ++i) {
+            int valor_vertice;
+            particao.inicio[i] = particao.num_arestas;
+            sucesso = ler_inteiro(&leitor, &valor_vertice);
+            // Arestas no formato (origem, destino, valor), terminadas por -1
+            int origem;
+            while (sucesso && (sucesso = ler_inteiro(&leitor, &origem)) && origem != -1) {
+                int destino, valor;
+                sucesso = ler_inteiro(&leitor, &destino) && ler_inteiro(&leitor, &valor);
+                if (sucesso && destino >= 0 && destino < num_vertices) {
+                    sucesso = garantir_capacidade(&particao.destino, &particao.cap_destino, particao.num_arestas + 1);
+                    if (sucesso) {
+                        particao.destino[particao.num_arestas++] = destino;
+                    }
+                }
+            }
+        }
+        if (sucesso) {
+            particao.inicio[particao.num_vertices] = particao.num_arestas;
+            sucesso = escrever_particao(prefixo, p, &particao);
+        }
+    }
+    fclose(leitor.ficheiro);
+    free(leitor.buffer);
+    free(particao.inicio);
+    free(particao.destino);
+    if (!sucesso) {
+        return false;
+    }
+
+    char nome[EXTERNO_MAX_NOME + 32];
+    snprintf(nome, sizeof(nome), "%s.meta", prefixo);
+    FILE* meta = fopen(nome, "wb");
+    if (!meta) {
+        return false;
+    }
+    sucesso = fwrite(&num_vertices, sizeof(int), 1, meta) == 1 &&
+        fwrite(&vertices_por_particao, sizeof(int), 1, meta) == 1 &&
+        fwrite(&num_particoes, sizeof(int), 1, meta) == 1;
+    return fclose(meta) == 0 && sucesso;
+}
+#pragma endregion
+
+
+#pragma region Abrir Grafo Externo
+/**
+ * @brief Abre um grafo particionado por particionar_grafo_binario
+ *
+ * @param prefixo Prefixo usado na particao
+ * @return Ponteiro para o grafo externo, ou NULL em caso de erro ou de metadados invalidos
+ *
+ * @autor Diogo Oliveira
+ */
+GrafoExterno* abrir_grafo_externo(const char* prefixo) {
+    if (prefixo == NULL || strlen(prefixo) >= EXTERNO_MAX_NOME) {
+        return NULL;
+    }
+    char nome[EXTERNO_MAX_NOME + 32];
+    snprintf(nome, sizeof(nome), "%s.meta", prefixo);
+    FILE* meta = fopen(nome, "rb");
+    if (!meta) {
+        return NULL;
+    }
+    GrafoExterno* externo = (GrafoExterno*)malloc(sizeof(GrafoExterno));
+    bool sucesso = externo != NULL &&
+        fread(&externo->num_vertices, sizeof(int), 1, meta) == 1 &&
+        fread(&externo->vertices_por_particao, sizeof(int), 1, meta) == 1 &&
+        fread(&externo->num_particoes, sizeof(int), 1, meta) == 1;
+    fclose(meta);
+    // Metadados incoerentes fariam a BFS ler particoes inexistentes ou escrever fora dos bitmaps
+    sucesso = sucesso && externo->num_vertices >= 0 && externo->vertices_por_particao > 0 &&
+        externo->num_particoes == ((long long)externo->num_vertices + externo->vertices_por_particao - 1) /
+        externo->vertices_por_particao;
+    if (!sucesso) {
+        free(externo);
+        return NULL;
+    }
+    strcpy(externo->prefixo, prefixo);
+    return externo;
+}
+#pragma endregion
+
+
+#pragma region Fechar Grafo Externo
+/**
+ * @brief Liberta a estrutura do grafo externo (os ficheiros em disco mantem-se)
+ *
+ * @param externo Ponteiro para o grafo externo
+ * @return true se foi libertado com sucesso, false caso contrario
+ *
+ * @autor Diogo Oliveira
+ */
+bool fechar_grafo_externo(GrafoExterno* externo) {
+    if (externo == NULL) {
+        return false;
+    }
+    free(externo);
+    return true;
+}
+#pragma endregion
+
+
+#pragma region BFS Externa
+/**
+ * @brief Calcula a distancia (numero de arestas) entre dois vertices de um grafo em disco
+ *
+ * A BFS avanca por niveis. Em memoria ficam apenas os bitmaps de visitados e das fronteiras atual
+ * e seguinte; em cada nivel sao lidas, por ordem, apenas as particoes com vertices na fronteira,
+ * enquanto uma thread auxiliar, criada uma so vez para toda a travessia, le a particao seguinte.
+ *
+ * @param externo Ponteiro para o grafo externo
+ * @param inicio Vertice de inicio
+ * @param destino Vertice de destino
+ * @return A distancia, ou -1 se nao existir caminho ou ocorrer um erro
+ *
+ * @autor Diogo Oliveira
+ */
+int bfs_externo_distancia(GrafoExterno* externo, int inicio, int destino) {
+    if (externo == NULL || inicio < 0 || destino < 0 ||
+        inicio >= externo->num_vertices || destino >= externo->num_vertices) {
+        return -1;
+    }
+    if (inicio == destino) {
+        return 0;
+    }
+
+    int palavras = (externo->num_vertices + 63) / 64;
+    uint64_t* visitado = (uint64_t*)calloc(palavras, sizeof(uint64_t));
+    uint64_t* fronteira = (uint64_t*)calloc(palavras, sizeof(uint64_t));
+    uint64_t* proxima = (uint64_t*)calloc(palavras, sizeof(uint64_t));
+    LeituraAntecipada leitura = { 0 };
+    leitura.externo = externo;
+    leitura.pedidos = criar_fila_concorrente((unsigned int)externo->num_particoes);
+    InitializeSRWLock(&leitura.trinco);
+    InitializeConditionVariable(&leitura.mudou);
+
+    int distancia = -1;
+    bool erro = visitado == NULL || fronteira == NULL || proxima == NULL || leitura.pedidos == NULL;
+    HANDLE leitor = NULL;
+    if (!erro) {
+        ativar_bit(visitado, inicio);
+        ativar_bit(fronteira, inicio);
+        leitor = CreateThread(NULL, 0, ler_antecipadamente, &leitura, 0, NULL);
+        erro = leitor == NULL;
+    }
+    // Buffers consumidos desde o inicio da travessia; a thread de leitura usa a mesma alternancia
+    unsigned int consumidos = 0;
+
+    for (int nivel = 1; !erro && distancia < 0; ++nivel) {
+        // Particoes com pelo menos um vertice na fronteira
+        int num_pedidos = 0;
+        for (int p = 0; p < externo->num_particoes; ++p) {
+            int primeiro = p * externo->vertices_por_particao;
+            int ultimo = primeiro + externo->vertices_por_particao;
+            if (ultimo > externo->num_vertices) {
+                ultimo = externo->num_vertices;
+            }
+            for (int v = primeiro; v < ultimo; ++v) {
+                if ((v & 63) == 0 && v + 64 <= ultimo && fronteira[v >> 6] == 0) {
+                    v += 63;
+                    continue;
+                }
+                if (bit_ativo(fronteira, v)) {
+                    // A fila tem lugar para todas as particoes e e esvaziada em cada nivel
+                    if (!fila_concorrente_enfileirar(leitura.pedidos, p)) {
+                        erro = true;
+                    }
+                    num_pedidos++;
+                    break;
+                }
+            }
+        }
+        if (erro || num_pedidos == 0) {
+            break;
+        }
+        // Passar pelo trinco garante que a thread nao perde o aviso entre verificar a fila e esperar
+        AcquireSRWLockExclusive(&leitura.trinco);
+        ReleaseSRWLockExclusive(&leitura.trinco);
+        WakeAllConditionVariable(&leitura.mudou);
+
+        for (int i = 0; i < num_pedidos; ++i) {
+            int slot = (int)(consumidos++ % 2);
+            AcquireSRWLockExclusive(&leitura.trinco);
+            while (!leitura.pronto[slot]) {
+                SleepConditionVariableSRW(&leitura.mudou, &leitura.trinco, INFINITE, 0);
+            }
+            bool falhou = leitura.erro;
+            ReleaseSRWLockExclusive(&leitura.trinco);
+            if (falhou) {
+                erro = true;
+                break;
+            }
+
+            Particao* particao = &leitura.buffers[slot];
+            for (int j = 0; j < particao->num_vertices; ++j) {
+                if (!bit_ativo(fronteira, particao->primeiro + j)) {
+                    continue;
+                }
+                for (int k = particao->inicio[j]; k < particao->inicio[j + 1]; ++k) {
+                    int w = particao->destino[k];
+                    if (!bit_ativo(visitado, w)) {
+                        ativar_bit(visitado, w);
+                        ativar_bit(proxima, w);
+                    }
+                }
+            }
+
+            AcquireSRWLockExclusive(&leitura.trinco);
+            leitura.pronto[slot] = false;
+            ReleaseSRWLockExclusive(&leitura.trinco);
+            WakeAllConditionVariable(&leitura.mudou);
+        }
+
+        if (!erro && bit_ativo(visitado, destino)) {
+            distancia = nivel;
+        }
+        uint64_t* trocar = fronteira;
+        fronteira = proxima;
+        proxima = trocar;
+        memset(proxima, 0, palavras * sizeof(uint64_t));
+    }
+
+    if (leitor != NULL) {
+        AcquireSRWLockExclusive(&leitura.trinco);
+        leitura.terminar = true;
+        ReleaseSRWLockExclusive(&leitura.trinco);
+        WakeAllConditionVariable(&leitura.mudou);
+        WaitForSingleObject(leitor, INFINITE);
+        CloseHandle(leitor);
+    }
+    destruir_fila_concorrente(leitura.pedidos);
+    free(leitura.buffers[0].inicio);
+    free(leitura.buffers[0].destino);
+    free(leitura.buffers[1].inicio);
+    free(leitura.buffers[1].destino);
+    free(visitado);
+    free(fronteira);
+    free(proxima);
+    return distancia;
+}
+#pragma endregion
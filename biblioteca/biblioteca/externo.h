@@ -0,0 +1,39 @@
+﻿/*******************************************************************************************************************
+* @file externo.h
+* @author Diogo Oliveira (a20468@alunos.ipca.pt)
+* @brief header responsável pela definiçao do grafo particionado em disco (memoria externa)
+* @date maio 2024 *
+*
+* @copyright Copyright (c) 2024
+*
+*******************************************************************************************************************/
+
+
+#ifndef EXTERNO_H
+#define EXTERNO_H
+
+#include <stdbool.h>
+
+#define EXTERNO_MAX_NOME 260 /**< Tamanho maximo do prefixo dos ficheiros das particoes */
+
+/**
+ * @brief Grafo cujas arestas estao divididas em ficheiros por intervalos de vertices
+ *
+ * A particao p contem, em formato CSR, as arestas dos vertices
+ * [p * vertices_por_particao, (p + 1) * vertices_por_particao).
+ *
+ * @autor Diogo Oliveira
+ */
+typedef struct GrafoExterno {
+    int num_vertices;              /**< Numero total de vertices */
+    int vertices_por_particao;     /**< Numero de vertices em cada particao */
+    int num_particoes;             /**< Numero de ficheiros de particao */
+    char prefixo[EXTERNO_MAX_NOME]; /**< Prefixo dos ficheiros (<prefixo>.meta e <prefixo>.<p>.part) */
+} GrafoExterno;
+
+
+bool particionar_grafo_binario(const char* nome_ficheiro, const char* prefixo, int vertices_por_particao);
+GrafoExterno* abrir_grafo_externo(const char* prefixo);
+bool fechar_grafo_externo(GrafoExterno* externo);
+int bfs_externo_distancia(GrafoExterno* externo, int inicio, int destino);
+#endif /* EXTERNO_H */
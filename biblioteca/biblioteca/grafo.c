@@ -21,6 +21,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "grafo.h"
+#include "distancias.h"
+#include "diario.h"
+#include "cache.h"
 
 
 #pragma region Criar Grafo
@@ -38,11 +41,43 @@ Grafo* criar_grafo() {
     }
     grafo->num_vertices = 0;
     grafo->lista_adj = NULL;
+    grafo->distancias = NULL;
+    grafo->diario = NULL;
+    grafo->bloco_nos = NULL;
+    grafo->tamanho_bloco_nos = 0;
+    grafo->bloco_arestas = NULL;
+    grafo->tamanho_bloco_arestas = 0;
+    grafo->versao = 0;
+    grafo->cache = NULL;
     return grafo;
 }
 #pragma endregion
 
 
+#pragma region Libertar Memoria
+/**
+ * @brief Liberta uma aresta, exceto se pertencer ao bloco alocado por construir_grafo_matriz
+ */
+static void libertar_aresta(Grafo* grafo, Aresta* aresta) {
+    if (grafo->bloco_arestas != NULL && aresta >= grafo->bloco_arestas &&
+        aresta < grafo->bloco_arestas + grafo->tamanho_bloco_arestas) {
+        return;
+    }
+    free(aresta);
+}
+
+/**
+ * @brief Liberta um vertice, exceto se pertencer ao bloco alocado por construir_grafo_matriz
+ */
+static void libertar_no(Grafo* grafo, No* no) {
+    if (grafo->bloco_nos != NULL && no >= grafo->bloco_nos && no < grafo->bloco_nos + grafo->tamanho_bloco_nos) {
+        return;
+    }
+    free(no);
+}
+#pragma endregion
+
+
 #pragma region Destruir Grafo
 /**
  * @brief Destroi um grafo, libertando toda a memoria alocada
@@ -56,21 +91,32 @@ bool destruir_grafo(Grafo* grafo) {
     if (grafo == NULL) {
         return false;
     }
+    if (grafo->distancias != NULL) {
+        destruir_distancias(grafo->distancias);
+    }
+    if (grafo->diario != NULL) {
+        fechar_diario(grafo->diario);
+    }
+    if (grafo->cache != NULL) {
+        destruir_cache_caminhos(grafo->cache);
+    }
     for (int i = 0; i < grafo->num_vertices; ++i) {
         No* atual = grafo->lista_adj[i];
         while (atual) {
             Aresta* aresta_atual = atual->lista_arestas;
             while (aresta_atual) {
                 Aresta* proxima_aresta = aresta_atual->prox;
-                free(aresta_atual);
+                libertar_aresta(grafo, aresta_atual);
                 aresta_atual = proxima_aresta;
             }
             No* proximo = atual->prox;
-            free(atual);
+            libertar_no(grafo, atual);
             atual = proximo;
         }
     }
     free(grafo->lista_adj);
+    free(grafo->bloco_nos);
+    free(grafo->bloco_arestas);
     free(grafo);
     return true;
 }
@@ -104,6 +150,11 @@ bool adicionar_vertice(Grafo* grafo, int valor) {
     grafo->lista_adj[grafo->num_vertices]->lista_arestas = NULL;
     grafo->lista_adj[grafo->num_vertices]->prox = NULL;
     grafo->num_vertices++;
+    grafo->versao++;
+    if (grafo->distancias != NULL && !distancias_vertice_adicionado(grafo->distancias)) {
+        distancias_reconstruir(grafo->distancias);
+    }
+    diario_registar(grafo->diario, DIARIO_ADICIONAR_VERTICE, valor, 0, 0);
     return true;
 }
 #pragma endregion
@@ -146,6 +197,11 @@ bool adicionar_aresta(Grafo* grafo, int origem, int destino, int valor) {
         }
         aresta_atual->prox = nova_aresta;
     }
+    grafo->versao++;
+    if (grafo->distancias != NULL && !distancias_aresta_adicionada(grafo->distancias, origem, destino)) {
+        distancias_reconstruir(grafo->distancias);
+    }
+    diario_registar(grafo->diario, DIARIO_ADICIONAR_ARESTA, origem, destino, valor);
     return true;
 }
 #pragma endregion
@@ -256,11 +312,11 @@ bool remover_vertice(Grafo* grafo, int valor) {
                 Aresta* aresta_atual = atual->lista_arestas;
                 while (aresta_atual) {
                     Aresta* proxima_aresta = aresta_atual->prox;
-                    free(aresta_atual);
+                    libertar_aresta(grafo, aresta_atual);
                     aresta_atual = proxima_aresta;
                 }
                 No* proximo = atual->prox;
-                free(atual);
+                libertar_no(grafo, atual);
                 atual = proximo;
             }
             // Deslocar os vertices e direita do vertice removido
@@ -268,12 +324,36 @@ bool remover_vertice(Grafo* grafo, int valor) {
                 grafo->lista_adj[j] = grafo->lista_adj[j + 1];
             }
             grafo->num_vertices--;
+            grafo->versao++;
+            // Remover as arestas que chegavam ao vertice e renumerar os indices deslocados
+            for (int j = 0; j < grafo->num_vertices; ++j) {
+                Aresta** ligacao = &grafo->lista_adj[j]->lista_arestas;
+                while (*ligacao) {
+                    Aresta* aresta_atual = *ligacao;
+                    if (aresta_atual->destino == i) {
+                        *ligacao = aresta_atual->prox;
+                        libertar_aresta(grafo, aresta_atual);
+                        continue;
+                    }
+                    if (aresta_atual->origem > i) {
+                        aresta_atual->origem--;
+                    }
+                    if (aresta_atual->destino > i) {
+                        aresta_atual->destino--;
+                    }
+                    ligacao = &aresta_atual->prox;
+                }
+            }
             // Redimensionar a lista de adjacencia
             No** nova_lista = realloc(grafo->lista_adj, grafo->num_vertices * sizeof(No*));
             if (grafo->num_vertices > 0 && nova_lista == NULL) {
                 return false;
             }
             grafo->lista_adj = nova_lista;
+            // Os indices dos vertices foram deslocados, por isso as origens das arvores BFS sao
+            // renumeradas e as arvores recalculadas (se falhar, ficam marcadas como desatualizadas)
+            distancias_vertice_removido(grafo->distancias, i);
+            diario_registar(grafo->diario, DIARIO_REMOVER_VERTICE, valor, 0, 0);
             return true;
         }
     }
@@ -309,7 +389,12 @@ bool remover_aresta(Grafo* grafo, int origem, int destino) {
             else {
                 anterior->prox = aresta_atual->prox;
             }
-            free(aresta_atual);
+            libertar_aresta(grafo, aresta_atual);
+            grafo->versao++;
+            if (grafo->distancias != NULL && !distancias_aresta_removida(grafo->distancias, origem, destino)) {
+                distancias_reconstruir(grafo->distancias);
+            }
+            diario_registar(grafo->diario, DIARIO_REMOVER_ARESTA, origem, destino, 0);
             return true;
         }
         anterior = aresta_atual;
@@ -320,6 +405,58 @@ bool remover_aresta(Grafo* grafo, int origem, int destino) {
 #pragma endregion
 
 
+#pragma region Escrever Grafo Binário
+/**
+ * @brief Acrescenta um inteiro ao buffer de escrita, despejando-o no ficheiro quando fica cheio
+ */
+static bool escrever_inteiro(FILE* arquivo, int* buffer, int* usados, int valor) {
+    if (*usados == GRAFO_BUFFER_ESCRITA) {
+        if (fwrite(buffer, sizeof(int), *usados, arquivo) != (size_t)*usados) {
+            return false;
+        }
+        *usados = 0;
+    }
+    buffer[(*usados)++] = valor;
+    return true;
+}
+
+/**
+ * @brief Escreve o grafo num ficheiro ja aberto, no formato de guardar_grafo_binario
+ *
+ * Os inteiros sao agrupados num buffer e escritos em blocos, em vez de um fwrite por inteiro.
+ *
+ * @param grafo Ponteiro para o grafo
+ * @param arquivo Ficheiro aberto em modo binario para escrita
+ * @return true se foi escrito com sucesso, false caso contrario
+ *
+ * @autor Diogo Oliveira
+ */
+bool escrever_grafo_binario(Grafo* grafo, FILE* arquivo) {
+    if (grafo == NULL || arquivo == NULL) {
+        return false;
+    }
+    int buffer[GRAFO_BUFFER_ESCRITA];
+    int usados = 0;
+    bool sucesso = escrever_inteiro(arquivo, buffer, &usados, grafo->num_vertices);
+
+    for (int i = 0; sucesso && i < grafo->num_vertices; ++i) {
+        No* no_atual = grafo->lista_adj[i];
+        sucesso = escrever_inteiro(arquivo, buffer, &usados, no_atual->valor);
+
+        Aresta* aresta_atual = no_atual->lista_arestas;
+        while (sucesso && aresta_atual) {
+            sucesso = escrever_inteiro(arquivo, buffer, &usados, aresta_atual->origem) &&
+                escrever_inteiro(arquivo, buffer, &usados, aresta_atual->destino) &&
+                escrever_inteiro(arquivo, buffer, &usados, aresta_atual->valor);
+            aresta_atual = aresta_atual->prox;
+        }
+        sucesso = sucesso && escrever_inteiro(arquivo, buffer, &usados, -1);
+    }
+    return sucesso && fwrite(buffer, sizeof(int), usados, arquivo) == (size_t)usados;
+}
+#pragma endregion
+
+
 #pragma region Guardar Grafo Binário
 /**
  * @brief Guarda o grafo em ficheiro binário
@@ -336,30 +473,81 @@ bool guardar_grafo_binario(Grafo* grafo, const char* nome_ficheiro) {
         printf("Erro");
         return false;
     }
+    bool sucesso = escrever_grafo_binario(grafo, arquivo);
+    if (fclose(arquivo) != 0 || !sucesso) {
+        printf("Erro");
+        return false;
+    }
+    printf("Grafo guardado\n");
+    return true;
+}
+#pragma endregion
 
-    // Escrever o número de vértices
-    fwrite(&grafo->num_vertices, sizeof(int), 1, arquivo);
 
-    // Escrever cada vértice e suas arestas
-    for (int i = 0; i < grafo->num_vertices; ++i) {
-        No* no_atual = grafo->lista_adj[i];
-        fwrite(&no_atual->valor, sizeof(int), 1, arquivo);
+#pragma region Carregar Grafo Binário
+/**
+ * @brief Carrega um grafo guardado com guardar_grafo_binario
+ *
+ * @param nome_ficheiro Nome do ficheiro binario
+ * @return Ponteiro para o grafo carregado, ou NULL em caso de erro
+ *
+ * @autor Diogo Oliveira
+ */
+Grafo* carregar_grafo_binario(const char* nome_ficheiro) {
+    FILE* arquivo = fopen(nome_ficheiro, "rb");
+    if (!arquivo) {
+        return NULL;
+    }
+    Grafo* grafo = criar_grafo();
+    int num_vertices = 0;
+    bool sucesso = grafo != NULL && fread(&num_vertices, sizeof(int), 1, arquivo) == 1 && num_vertices >= 0;
+    if (sucesso && num_vertices > 0) {
+        // Os vertices sao criados todos primeiro, porque as arestas podem apontar para vertices seguintes
+        grafo->lista_adj = (No**)calloc(num_vertices, sizeof(No*));
+        sucesso = grafo->lista_adj != NULL;
+        for (int i = 0; sucesso && i < num_vertices; ++i) {
+            grafo->lista_adj[i] = (No*)malloc(sizeof(No));
+            if (grafo->lista_adj[i] == NULL) {
+                sucesso = false;
+                break;
+            }
+            grafo->lista_adj[i]->valor = 0;
+            grafo->lista_adj[i]->lista_arestas = NULL;
+            grafo->lista_adj[i]->prox = NULL;
+            grafo->num_vertices++;
+        }
+    }
 
-        // Escrever as arestas do vértice
-        Aresta* aresta_atual = no_atual->lista_arestas;
-        while (aresta_atual) {
-            fwrite(&aresta_atual->origem, sizeof(int), 1, arquivo);
-            fwrite(&aresta_atual->destino, sizeof(int), 1, arquivo);
-            fwrite(&aresta_atual->valor, sizeof(int), 1, arquivo);
-            aresta_atual = aresta_atual->prox;
+    for (int i = 0; sucesso && i < num_vertices; ++i) {
+        No* no_atual = grafo->lista_adj[i];
+        Aresta** fim = &no_atual->lista_arestas;
+        sucesso = fread(&no_atual->valor, sizeof(int), 1, arquivo) == 1;
+        int origem;
+        while (sucesso && (sucesso = fread(&origem, sizeof(int), 1, arquivo) == 1) && origem != -1) {
+            // Cada aresta e guardada na lista do seu vertice de origem
+            if (origem != i) {
+                sucesso = false;
+                break;
+            }
+            Aresta* nova_aresta = (Aresta*)malloc(sizeof(Aresta));
+            if (nova_aresta == NULL) {
+                sucesso = false;
+                break;
+            }
+            nova_aresta->origem = origem;
+            nova_aresta->prox = NULL;
+            *fim = nova_aresta;
+            fim = &nova_aresta->prox;
+            sucesso = fread(&nova_aresta->destino, sizeof(int), 1, arquivo) == 1 &&
+                fread(&nova_aresta->valor, sizeof(int), 1, arquivo) == 1 &&
+                nova_aresta->destino >= 0 && nova_aresta->destino < num_vertices;
         }
-        int fim_lista = -1;
-        fwrite(&fim_lista, sizeof(int), 1, arquivo);
     }
-    return true;
     fclose(arquivo);
-    printf("Grafo guardado");
-
+    if (!sucesso) {
+        destruir_grafo(grafo);
+        return NULL;
+    }
+    return grafo;
 }
-
-#pragma endregion
\ No newline at end of file
+#pragma endregion
@@ -13,11 +13,14 @@
 #define GRAFO_H
 
 #include <stdbool.h> 
+#include <stdio.h>
 
 
 
 #pragma warning (disable: 4996)
 
+#define GRAFO_BUFFER_ESCRITA 4096 /**< Inteiros agrupados em cada fwrite ao guardar o grafo */
+
 /**
  * @brief Estrutura para representar uma aresta na lista de adjacencia
  * 
@@ -49,6 +52,14 @@ typedef struct No {
 typedef struct Grafo {
     int num_vertices; /**< Numero de vertices no grafo */
     No** lista_adj;   /**< Ponteiro para um array de ponteiros para nos (lista de adjacencia) */
+    struct Distancias* distancias; /**< Arvores BFS mantidas incrementalmente (NULL se nao existirem) */
+    struct Diario* diario;         /**< Diario onde as alteracoes sao registadas (NULL se nao existir) */
+    No* bloco_nos;                 /**< Vertices alocados de uma so vez por construir_grafo_matriz (ou NULL) */
+    int tamanho_bloco_nos;         /**< Numero de vertices em bloco_nos */
+    Aresta* bloco_arestas;         /**< Arestas alocadas de uma so vez por construir_grafo_matriz (ou NULL) */
+    size_t tamanho_bloco_arestas;  /**< Numero de arestas em bloco_arestas */
+    unsigned long long versao;     /**< Incrementada por cada alteracao do grafo (64 bits: nunca da a volta) */
+    struct CacheCaminhos* cache;   /**< Cache de resultados de caminhos (NULL se nao existir) */
 } Grafo;
 
 
@@ -56,6 +67,12 @@ Grafo* criar_grafo();
 bool destruir_grafo(Grafo* grafo);
 bool adicionar_vertice(Grafo* grafo, int valor);
 bool adicionar_aresta(Grafo* grafo, int origem, int destino, int valor);
+bool remover_vertice(Grafo* grafo, int valor);
+bool remover_aresta(Grafo* grafo, int origem, int destino);
+bool conectar_vertices_linha(Grafo* grafo, int matriz[5][5], int linha, int coluna);
+bool conectar_vertices_coluna(Grafo* grafo, int matriz[5][5], int linha, int coluna);
 bool imprimir_grafo(Grafo* grafo);
 bool guardar_grafo_binario(Grafo* grafo, const char* nome_ficheiro);
+bool escrever_grafo_binario(Grafo* grafo, FILE* arquivo);
+Grafo* carregar_grafo_binario(const char* nome_ficheiro);
 #endif /* GRAFO_H */
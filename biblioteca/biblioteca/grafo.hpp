@@ -0,0 +1,326 @@
+﻿/*******************************************************************************************************************
+* @file grafo.hpp
+* @author Diogo Oliveira (a20468@alunos.ipca.pt)
+* @brief header responsável pela interface C++ (so com templates) para grafos de matrizes de dimensao fixa
+* @date maio 2024 *
+*
+* @copyright Copyright (c) 2024
+*
+*******************************************************************************************************************/
+
+
+#ifndef GRAFO_HPP
+#define GRAFO_HPP
+
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+extern "C" {
+#include "grafo.h"
+#include "bfs.h"
+#include "construcao.h"
+}
+
+namespace eda {
+
+/**
+ * @brief Liberta um Grafo com destruir_grafo, para uso com std::unique_ptr
+ *
+ * @autor Diogo Oliveira
+ */
+struct DestruirGrafo {
+    void operator()(Grafo* grafo) const noexcept {
+        destruir_grafo(grafo);
+    }
+};
+
+/**
+ * @brief Posse exclusiva de um Grafo: pode ser movida mas nao copiada, e destroi o grafo no fim
+ */
+using GrafoPtr = std::unique_ptr<Grafo, DestruirGrafo>;
+
+
+/**
+ * @brief Calculos de indices de uma matriz Linhas x Colunas, todos avaliados em tempo de compilacao
+ *
+ * A celula (linha, coluna) e o vertice linha * Colunas + coluna, como em construir_grafo_matriz.
+ *
+ * @autor Diogo Oliveira
+ */
+template <int Linhas, int Colunas>
+struct IndicesMatriz {
+    static_assert(Linhas > 0 && Colunas > 0, "a matriz tem de ter pelo menos uma linha e uma coluna");
+
+    static constexpr int num_vertices() noexcept { return Linhas * Colunas; }
+    static constexpr int grau() noexcept { return (Colunas - 1) + (Linhas - 1); }
+    static constexpr int indice(int linha, int coluna) noexcept { return linha * Colunas + coluna; }
+    static constexpr int linha(int vertice) noexcept { return vertice / Colunas; }
+    static constexpr int coluna(int vertice) noexcept { return vertice % Colunas; }
+
+    /**
+     * @brief k-esimo vizinho de um vertice (0 <= k < grau()), pela ordem das arestas do grafo:
+     *        primeiro as restantes celulas da linha, depois as restantes celulas da coluna
+     */
+    static constexpr int vizinho(int vertice, int k) noexcept {
+        return k < Colunas - 1
+            ? indice(linha(vertice), k < coluna(vertice) ? k : k + 1)
+            : indice(k - (Colunas - 1) < linha(vertice) ? k - (Colunas - 1) : k - (Colunas - 1) + 1, coluna(vertice));
+    }
+};
+
+
+/**
+ * @brief Vizinho de um vertice e peso da aresta que os liga
+ */
+template <typename Peso>
+struct Vizinho {
+    int vertice; /**< Vertice de destino */
+    Peso peso;   /**< Peso da aresta (soma dos valores das duas celulas) */
+};
+
+
+/**
+ * @brief Iterador sobre os vizinhos de um vertice na matriz, calculados sem percorrer listas
+ *
+ * @autor Diogo Oliveira
+ */
+template <int Linhas, int Colunas, typename Peso>
+class IteradorVizinhos {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Vizinho<Peso>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = Vizinho<Peso>;
+
+    constexpr IteradorVizinhos(const Peso* valores, int vertice, int k) noexcept
+        : valores_(valores), vertice_(vertice), k_(k) {}
+
+    Vizinho<Peso> operator*() const noexcept {
+        int destino = IndicesMatriz<Linhas, Colunas>::vizinho(vertice_, k_);
+        return Vizinho<Peso>{ destino, static_cast<Peso>(valores_[vertice_] + valores_[destino]) };
+    }
+    IteradorVizinhos& operator++() noexcept {
+        ++k_;
+        return *this;
+    }
+    IteradorVizinhos operator++(int) noexcept {
+        IteradorVizinhos anterior = *this;
+        ++k_;
+        return anterior;
+    }
+    bool operator==(const IteradorVizinhos& outro) const noexcept { return k_ == outro.k_; }
+    bool operator!=(const IteradorVizinhos& outro) const noexcept { return k_ != outro.k_; }
+
+private:
+    const Peso* valores_;
+    int vertice_;
+    int k_;
+};
+
+/**
+ * @brief Intervalo para percorrer os vizinhos de um vertice com um ciclo for
+ */
+template <int Linhas, int Colunas, typename Peso>
+class VizinhosMatriz {
+public:
+    constexpr VizinhosMatriz(const Peso* valores, int vertice) noexcept : valores_(valores), vertice_(vertice) {}
+
+    IteradorVizinhos<Linhas, Colunas, Peso> begin() const noexcept { return { valores_, vertice_, 0 }; }
+    IteradorVizinhos<Linhas, Colunas, Peso> end() const noexcept {
+        return { valores_, vertice_, IndicesMatriz<Linhas, Colunas>::grau() };
+    }
+    static constexpr int size() noexcept { return IndicesMatriz<Linhas, Colunas>::grau(); }
+
+private:
+    const Peso* valores_;
+    int vertice_;
+};
+
+
+/**
+ * @brief Iterador sobre as arestas de um vertice no grafo C (lista ligada)
+ *
+ * @autor Diogo Oliveira
+ */
+class IteradorArestas {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Aresta;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Aresta*;
+    using reference = const Aresta&;
+
+    explicit IteradorArestas(const Aresta* aresta) noexcept : aresta_(aresta) {}
+
+    const Aresta& operator*() const noexcept { return *aresta_; }
+    const Aresta* operator->() const noexcept { return aresta_; }
+    IteradorArestas& operator++() noexcept {
+        aresta_ = aresta_->prox;
+        return *this;
+    }
+    IteradorArestas operator++(int) noexcept {
+        IteradorArestas anterior = *this;
+        aresta_ = aresta_->prox;
+        return anterior;
+    }
+    bool operator==(const IteradorArestas& outro) const noexcept { return aresta_ == outro.aresta_; }
+    bool operator!=(const IteradorArestas& outro) const noexcept { return aresta_ != outro.aresta_; }
+
+private:
+    const Aresta* aresta_;
+};
+
+/**
+ * @brief Intervalo para percorrer as arestas de um vertice com um ciclo for
+ */
+class ArestasVertice {
+public:
+    explicit ArestasVertice(const Aresta* primeira) noexcept : primeira_(primeira) {}
+
+    IteradorArestas begin() const noexcept { return IteradorArestas(primeira_); }
+    IteradorArestas end() const noexcept { return IteradorArestas(nullptr); }
+
+private:
+    const Aresta* primeira_;
+};
+
+
+/**
+ * @brief Caminho de tamanho maximo fixo, sem alocacao dinamica
+ */
+template <std::size_t Maximo>
+struct Caminho {
+    std::array<int, Maximo> vertices; /**< Vertices do caminho, de inicio para destino */
+    int comprimento;                  /**< Numero de vertices (0 se nao existir caminho, -1 em caso de erro) */
+    int soma;                         /**< Soma dos valores dos vertices do caminho, ou -1 */
+
+    const int* begin() const noexcept { return vertices.data(); }
+    const int* end() const noexcept { return vertices.data() + (comprimento > 0 ? comprimento : 0); }
+    explicit operator bool() const noexcept { return comprimento > 0; }
+};
+
+
+/**
+ * @brief Grafo de uma matriz Linhas x Colunas, com cada celula ligada as restantes da sua linha e coluna
+ *
+ * Guarda os valores da matriz num std::array (com o tipo Peso) e o Grafo C construido por
+ * construir_grafo_matriz, que destroi no fim. Pode ser movido mas nao copiado. O grafo C so
+ * guarda inteiros, por isso com Peso nao inteiro os valores sao convertidos para int no grafo C,
+ * e peso() e vizinhos() continuam a devolver os valores exatos.
+ *
+ * Exemplo:
+ *     eda::GrafoMatriz<5, 5>::Matriz matriz = { ... };
+ *     eda::GrafoMatriz<5, 5> grafo(matriz);
+ *     for (auto vizinho : grafo.vizinhos(grafo.indice(2, 3))) { ... }
+ *
+ * @autor Diogo Oliveira
+ */
+template <int Linhas, int Colunas, typename Peso = int>
+class GrafoMatriz : public IndicesMatriz<Linhas, Colunas> {
+    static_assert(std::is_arithmetic<Peso>::value, "o peso tem de ser um tipo aritmetico");
+
+public:
+    using Indices = IndicesMatriz<Linhas, Colunas>;
+    using Matriz = std::array<Peso, Linhas * Colunas>; /**< Valores das celulas, linha a linha */
+
+    /**
+     * @brief Constroi o grafo da matriz
+     *
+     * @param valores Valores das celulas, linha a linha
+     * @param num_threads Numero de threads a usar (<= 0 para usar todos os processadores)
+     * @throw std::bad_alloc se o grafo nao puder ser construido
+     */
+    explicit GrafoMatriz(const Matriz& valores, int num_threads = 0) : valores_(valores) {
+        std::array<int, Linhas * Colunas> inteiros;
+        for (int v = 0; v < Indices::num_vertices(); ++v) {
+            inteiros[v] = static_cast<int>(valores_[v]);
+        }
+        grafo_.reset(construir_grafo_matriz(inteiros.data(), Linhas, Colunas, num_threads));
+        if (!grafo_) {
+            throw std::bad_alloc();
+        }
+    }
+
+    GrafoMatriz(const GrafoMatriz&) = delete;
+    GrafoMatriz& operator=(const GrafoMatriz&) = delete;
+    GrafoMatriz(GrafoMatriz&&) noexcept = default;
+    GrafoMatriz& operator=(GrafoMatriz&&) noexcept = default;
+    ~GrafoMatriz() = default;
+
+    /** @brief Grafo C, para usar com as restantes funcoes da biblioteca (NULL depois de movido) */
+    Grafo* get() noexcept { return grafo_.get(); }
+    const Grafo* get() const noexcept { return grafo_.get(); }
+
+    /** @brief Deixa de ser dono do grafo C, que passa a ter de ser destruido por quem o recebe */
+    Grafo* libertar() noexcept { return grafo_.release(); }
+
+    Peso valor(int vertice) const noexcept { return valores_[vertice]; }
+    Peso valor(int linha, int coluna) const noexcept { return valores_[Indices::indice(linha, coluna)]; }
+    const Matriz& valores() const noexcept { return valores_; }
+
+    /** @brief Peso da aresta entre duas celulas da mesma linha ou coluna */
+    Peso peso(int origem, int destino) const noexcept {
+        return static_cast<Peso>(valores_[origem] + valores_[destino]);
+    }
+
+    /** @brief Vizinhos de um vertice, calculados a partir das dimensoes da matriz */
+    VizinhosMatriz<Linhas, Colunas, Peso> vizinhos(int vertice) const noexcept {
+        return VizinhosMatriz<Linhas, Colunas, Peso>(valores_.data(), vertice);
+    }
+
+    /**
+     * @brief Chama funcao(vizinho, peso) para cada vizinho de um vertice
+     *
+     * Os dois ciclos tem um numero de iteracoes conhecido em tempo de compilacao, o que permite ao
+     * compilador desenrola-los e vetoriza-los.
+     */
+    template <typename Funcao>
+    void para_cada_vizinho(int vertice, Funcao&& funcao) const {
+        const int linha = Indices::linha(vertice);
+        const int coluna = Indices::coluna(vertice);
+        const Peso base = valores_[vertice];
+        const Peso* valores_linha = valores_.data() + Indices::indice(linha, 0);
+        for (int k = 0; k < Colunas; ++k) {
+            if (k != coluna) {
+                funcao(Indices::indice(linha, k), static_cast<Peso>(base + valores_linha[k]));
+            }
+        }
+        for (int k = 0; k < Linhas; ++k) {
+            if (k != linha) {
+                funcao(Indices::indice(k, coluna), static_cast<Peso>(base + valores_[Indices::indice(k, coluna)]));
+            }
+        }
+    }
+
+    /** @brief Arestas de um vertice no grafo C, incluindo as adicionadas depois com adicionar_aresta */
+    ArestasVertice arestas(int vertice) const noexcept {
+        return ArestasVertice(grafo_->lista_adj[vertice]->lista_arestas);
+    }
+
+    /** @brief Caminho mais curto por BFS (ver bfs_obter_caminho), sem alocacao dinamica */
+    Caminho<Linhas * Colunas> caminho(int inicio, int destino) const {
+        Caminho<Linhas * Colunas> resultado;
+        resultado.soma = -1;
+        resultado.comprimento = bfs_obter_caminho(grafo_.get(), inicio, destino, resultado.vertices.data(),
+                                                  Indices::num_vertices(), &resultado.soma);
+        return resultado;
+    }
+
+    /** @brief Guarda o grafo C em ficheiro binario (ver guardar_grafo_binario) */
+    bool guardar(const char* nome_ficheiro) const {
+        return guardar_grafo_binario(grafo_.get(), nome_ficheiro);
+    }
+
+private:
+    Matriz valores_;
+    GrafoPtr grafo_;
+};
+
+} // namespace eda
+
+#endif /* GRAFO_HPP */
@@ -0,0 +1,662 @@
+﻿/*******************************************************************************************************************
+* @file ingestao.c
+* @brief Leitura de uma matriz de um ficheiro para um grafo, em pipeline (leitura, conversao e construcao)
+** @autor Diogo Oliveira (a20468@alunos.ipca.pt)
+* Este ficheiro contém a implementação das seguintes funcionalidades:
+* - Leitura do ficheiro em blocos grandes, cortados no fim de uma linha, por uma thread propria
+* - Conversao dos blocos em linhas de inteiros por varias threads
+* - Construcao dos vertices e das arestas de cada linha a medida que as linhas chegam, por ordem
+* - Ligacao das arestas de cada coluna, em paralelo, depois de chegar a ultima linha
+* - Filas limitadas entre as etapas, para que nenhuma avance demasiado sobre a seguinte
+* @date maio 2024
+*
+* @copyright Copyright (c) 2024
+*
+*******************************************************************************************************************/
+
+
+
+#include <windows.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "grafo.h"
+#include "ingestao.h"
+
+
+/**
+ * @brief Pedaco do ficheiro com linhas completas
+ */
+typedef struct BlocoTexto {
+    int sequencia;  /**< Posicao do bloco no ficheiro */
+    size_t tamanho; /**< Numero de bytes */
+    char* dados;    /**< Texto do bloco */
+} BlocoTexto;
+
+/**
+ * @brief Linhas de inteiros convertidas a partir de um bloco
+ */
+typedef struct LoteLinhas {
+    int sequencia;           /**< Sequencia do bloco de onde vieram as linhas */
+    int num_linhas;          /**< Numero de linhas nao vazias */
+    int* contagens;          /**< Numero de valores de cada linha */
+    int* valores;            /**< Valores de todas as linhas, seguidos */
+    struct LoteLinhas* prox; /**< Proximo lote na lista de lotes que chegaram fora de ordem */
+} LoteLinhas;
+
+/**
+ * @brief Fila limitada bloqueante entre duas etapas
+ */
+typedef struct FilaLimitada {
+    void** itens;                 /**< Buffer circular */
+    int capacidade;               /**< Numero maximo de itens */
+    int frente;                   /**< Indice do proximo item a retirar */
+    int tamanho;                  /**< Numero de itens na fila */
+    bool fechada;                 /**< Nao chegam mais itens */
+    SRWLOCK trinco;               /**< Protege os campos anteriores */
+    CONDITION_VARIABLE nao_cheia; /**< Sinalizada quando e retirado um item */
+    CONDITION_VARIABLE nao_vazia; /**< Sinalizada quando e colocado um item ou a fila fecha */
+} FilaLimitada;
+
+/**
+ * @brief Estado partilhado pelas threads do pipeline
+ */
+typedef struct Ingestao {
+    FILE* arquivo;                    /**< Ficheiro a ler */
+    FilaLimitada blocos;              /**< Da leitura para a conversao */
+    FilaLimitada lotes;               /**< Da conversao para a construcao */
+    volatile LONG conversores_ativos; /**< O ultimo conversor a terminar fecha a fila de lotes */
+    volatile LONG erro;               /**< Diferente de 0 se alguma etapa falhou */
+} Ingestao;
+
+/**
+ * @brief Grafo em construcao: vertices e arestas de linha crescem a medida que as linhas chegam
+ */
+typedef struct Construtor {
+    Grafo* grafo;          /**< Grafo em construcao (bloco_nos cresce por realloc) */
+    int linhas;            /**< Linhas ja construidas */
+    int colunas;           /**< Valores por linha, definido pela primeira linha */
+    size_t cap_nos;        /**< Vertices alocados em bloco_nos */
+    Aresta* arestas;       /**< Arestas de linha, colunas - 1 por vertice */
+    size_t cap_arestas;    /**< Arestas alocadas */
+} Construtor;
+
+/**
+ * @brief Trabalho de cada thread na ligacao final: um intervalo de linhas da matriz
+ */
+typedef struct TrabalhoLigacao {
+    Grafo* grafo;           /**< Grafo com todos os vertices e arestas de linha */
+    const int* transposta;  /**< Valores por colunas, para ler cada coluna de forma contigua */
+    int linhas;             /**< Numero de linhas da matriz */
+    int colunas;            /**< Numero de colunas da matriz */
+    int linha_inicio;       /**< Primeira linha desta thread */
+    int linha_fim;          /**< Linha seguinte a ultima desta thread */
+} TrabalhoLigacao;
+
+
+#pragma region Funcoes Auxiliares
+/**
+ * @brief Inicializa uma fila limitada vazia
+ */
+static bool iniciar_fila_limitada(FilaLimitada* fila, int capacidade) {
+    fila->itens = (void**)malloc(capacidade * sizeof(void*));
+    if (fila->itens == NULL) {
+        return false;
+    }
+    fila->capacidade = capacidade;
+    fila->frente = 0;
+    fila->tamanho = 0;
+    fila->fechada = false;
+    InitializeSRWLock(&fila->trinco);
+    InitializeConditionVariable(&fila->nao_cheia);
+    InitializeConditionVariable(&fila->nao_vazia);
+    return true;
+}
+
+/**
+ * @brief Coloca um item na fila, esperando enquanto estiver cheia
+ */
+static void colocar_fila_limitada(FilaLimitada* fila, void* item) {
+    AcquireSRWLockExclusive(&fila->trinco);
+    while (fila->tamanho == fila->capacidade) {
+        SleepConditionVariableSRW(&fila->nao_cheia, &fila->trinco, INFINITE, 0);
+    }
+    fila->itens[(fila->frente + fila->tamanho) % fila->capacidade] = item;
+    fila->tamanho++;
+    ReleaseSRWLockExclusive(&fila->trinco);
+    WakeConditionVariable(&fila->nao_vazia);
+}
+
+/**
+ * @brief Retira um item da fila, esperando enquanto estiver vazia; NULL se a fila fechou e esvaziou
+ */
+static void* retirar_fila_limitada(FilaLimitada* fila) {
+    AcquireSRWLockExclusive(&fila->trinco);
+    while (fila->tamanho == 0 && !fila->fechada) {
+        SleepConditionVariableSRW(&fila->nao_vazia, &fila->trinco, INFINITE, 0);
+    }
+    void* item = NULL;
+    if (fila->tamanho > 0) {
+        item = fila->itens[fila->frente];
+        fila->frente = (fila->frente + 1) % fila->capacidade;
+        fila->tamanho--;
+    }
+    ReleaseSRWLockExclusive(&fila->trinco);
+    if (item != NULL) {
+        WakeConditionVariable(&fila->nao_cheia);
+    }
+    return item;
+}
+
+/**
+ * @brief Indica que nao serao colocados mais itens e acorda quem espera por eles
+ */
+static void fechar_fila_limitada(FilaLimitada* fila) {
+    AcquireSRWLockExclusive(&fila->trinco);
+    fila->fechada = true;
+    ReleaseSRWLockExclusive(&fila->trinco);
+    WakeAllConditionVariable(&fila->nao_vazia);
+}
+
+/**
+ * @brief Liberta um bloco de texto
+ */
+static void libertar_bloco(BlocoTexto* bloco) {
+    free(bloco->dados);
+    free(bloco);
+}
+
+/**
+ * @brief Liberta um lote de linhas
+ */
+static void libertar_lote(LoteLinhas* lote) {
+    free(lote->contagens);
+    free(lote->valores);
+    free(lote);
+}
+
+/**
+ * @brief Thread de leitura: le o ficheiro em blocos e corta cada um a seguir ao ultimo '\n'
+ *
+ * O que fica depois do ultimo '\n' passa para o inicio do bloco seguinte, para que nenhuma
+ * linha seja dividida entre dois blocos.
+ */
+static DWORD WINAPI ler_blocos(LPVOID parametro) {
+    Ingestao* ingestao = (Ingestao*)parametro;
+    char* resto = NULL;
+    size_t tamanho_resto = 0;
+    int sequencia = 0;
+
+    while (!ingestao->erro) {
+        BlocoTexto* bloco = (BlocoTexto*)malloc(sizeof(BlocoTexto));
+        char* dados = (char*)malloc(tamanho_resto + INGESTAO_TAMANHO_BLOCO);
+        if (bloco == NULL || dados == NULL) {
+            free(bloco);
+            free(dados);
+            InterlockedExchange(&ingestao->erro, 1);
+            break;
+        }
+        if (tamanho_resto > 0) {
+            memcpy(dados, resto, tamanho_resto);
+        }
+        size_t lidos = fread(dados + tamanho_resto, 1, INGESTAO_TAMANHO_BLOCO, ingestao->arquivo);
+        if (lidos == 0 && ferror(ingestao->arquivo)) {
+            free(bloco);
+            free(dados);
+            InterlockedExchange(&ingestao->erro, 1);
+            break;
+        }
+        size_t total = tamanho_resto + lidos;
+        size_t fim = total;
+        if (lidos > 0) {
+            while (fim > 0 && dados[fim - 1] != '\n') {
+                fim--;
+            }
+        }
+
+        // Guardar o que sobra para o proximo bloco
+        tamanho_resto = total - fim;
+        if (tamanho_resto > 0) {
+            char* novo_resto = (char*)realloc(resto, tamanho_resto);
+            if (novo_resto == NULL) {
+                free(bloco);
+                free(dados);
+                InterlockedExchange(&ingestao->erro, 1);
+                break;
+            }
+            resto = novo_resto;
+            memcpy(resto, dados + fim, tamanho_resto);
+        }
+
+        if (fim == 0) {
+            // Bloco sem nenhuma linha completa (fim do ficheiro, ou linha maior do que um bloco)
+            free(bloco);
+            free(dados);
+            if (lidos == 0) {
+                break;
+            }
+            continue;
+        }
+        bloco->sequencia = sequencia++;
+        bloco->tamanho = fim;
+        bloco->dados = dados;
+        colocar_fila_limitada(&ingestao->blocos, bloco);
+        if (lidos == 0) {
+            break;
+        }
+    }
+    free(resto);
+    fechar_fila_limitada(&ingestao->blocos);
+    return 0;
+}
+
+/**
+ * @brief Converte um bloco em linhas de inteiros separados por ';' (ou espacos)
+ *
+ * Linhas vazias sao ignoradas. Devolve NULL se o bloco tiver caracteres invalidos, valores fora de
+ * INT_MIN..INT_MAX ou faltar memoria.
+ */
+static LoteLinhas* converter_bloco(const BlocoTexto* bloco) {
+    // Cada valor e cada linha nao vazia ocupam pelo menos dois caracteres, exceto o ultimo
+    size_t maximo = bloco->tamanho / 2 + 1;
+    LoteLinhas* lote = (LoteLinhas*)malloc(sizeof(LoteLinhas));
+    if (lote == NULL) {
+        return NULL;
+    }
+    lote->sequencia = bloco->sequencia;
+    lote->num_linhas = 0;
+    lote->contagens = (int*)malloc(maximo * sizeof(int));
+    lote->valores = (int*)malloc(maximo * sizeof(int));
+    lote->prox = NULL;
+    if (lote->contagens == NULL || lote->valores == NULL) {
+        libertar_lote(lote);
+        return NULL;
+    }
+
+    const char* p = bloco->dados;
+    const char* fim = bloco->dados + bloco->tamanho;
+    int num_valores = 0;
+    while (p < fim) {
+        int contagem = 0;
+        while (p < fim && *p != '\n') {
+            char c = *p;
+            if (c == ';' || c == ' ' || c == '\t' || c == '\r') {
+                p++;
+                continue;
+            }
+            bool negativo = false;
+            if (c == '-' || c == '+') {
+                negativo = c == '-';
+                p++;
+            }
+            if (p >= fim || *p < '0' || *p > '9') {
+                libertar_lote(lote);
+                return NULL;
+            }
+            // Acumulado em long long; um valor fora de int e um erro, tal como um caracter invalido
+            long long valor = 0;
+            while (p < fim && *p >= '0' && *p <= '9') {
+                valor = valor * 10 + (*p - '0');
+                if (valor > (long long)INT_MAX + 1) {
+                    libertar_lote(lote);
+                    return NULL;
+                }
+                p++;
+            }
+            valor = negativo ? -valor : valor;
+            if (valor > INT_MAX) {
+                libertar_lote(lote);
+                return NULL;
+            }
+            lote->valores[num_valores++] = (int)valor;
+            contagem++;
+        }
+        if (contagem > 0) {
+            lote->contagens[lote->num_linhas++] = contagem;
+        }
+        p++;
+    }
+    return lote;
+}
+
+/**
+ * @brief Thread de conversao: converte blocos em lotes ate a fila de blocos fechar
+ */
+static DWORD WINAPI converter_blocos(LPVOID parametro) {
+    Ingestao* ingestao = (Ingestao*)parametro;
+    BlocoTexto* bloco;
+    while ((bloco = (BlocoTexto*)retirar_fila_limitada(&ingestao->blocos)) != NULL) {
+        // Depois de um erro continua a esvaziar a fila, para a leitura nunca ficar bloqueada
+        LoteLinhas* lote = ingestao->erro ? NULL : converter_bloco(bloco);
+        libertar_bloco(bloco);
+        if (lote != NULL) {
+            colocar_fila_limitada(&ingestao->lotes, lote);
+        }
+        else {
+            InterlockedExchange(&ingestao->erro, 1);
+        }
+    }
+    if (InterlockedDecrement(&ingestao->conversores_ativos) == 0) {
+        fechar_fila_limitada(&ingestao->lotes);
+    }
+    return 0;
+}
+
+/**
+ * @brief Acrescenta uma linha ao grafo: os seus vertices e as arestas entre celulas da linha
+ */
+static bool adicionar_linha(Construtor* construtor, const int* valores, int contagem) {
+    if (construtor->linhas == 0) {
+        construtor->colunas = contagem;
+    }
+    else if (contagem != construtor->colunas) {
+        return false;
+    }
+    int colunas = construtor->colunas;
+    Grafo* grafo = construtor->grafo;
+    // Os indices dos vertices sao int
+    if ((long long)(construtor->linhas + 1) * colunas > INT_MAX) {
+        return false;
+    }
+    size_t num_nos = (size_t)(construtor->linhas + 1) * colunas;
+    size_t num_arestas = num_nos * (colunas - 1);
+
+    if (num_nos > construtor->cap_nos) {
+        size_t nova_cap = construtor->cap_nos > 0 ? 2 * construtor->cap_nos : num_nos;
+        while (nova_cap < num_nos) {
+            nova_cap *= 2;
+        }
+        No* novos = (No*)realloc(grafo->bloco_nos, nova_cap * sizeof(No));
+        if (novos == NULL) {
+            return false;
+        }
+        grafo->bloco_nos = novos;
+        construtor->cap_nos = nova_cap;
+    }
+    if (num_arestas > construtor->cap_arestas) {
+        size_t nova_cap = construtor->cap_arestas > 0 ? 2 * construtor->cap_arestas : num_arestas;
+        while (nova_cap < num_arestas) {
+            nova_cap *= 2;
+        }
+        Aresta* novas = (Aresta*)realloc(construtor->arestas, nova_cap * sizeof(Aresta));
+        if (novas == NULL) {
+            return false;
+        }
+        construtor->arestas = novas;
+        construtor->cap_arestas = nova_cap;
+    }
+
+    // Os ponteiros (lista_arestas e prox) so sao ligados no fim, porque os blocos ainda podem mudar
+    int primeiro = construtor->linhas * colunas;
+    for (int j = 0; j < colunas; ++j) {
+        int v = primeiro + j;
+        grafo->bloco_nos[v].valor = valores[j];
+        grafo->bloco_nos[v].prox = NULL;
+        Aresta* aresta = construtor->arestas + (size_t)v * (colunas - 1);
+        for (int k = 0; k < colunas; ++k) {
+            if (k != j) {
+                aresta->origem = v;
+                aresta->destino = primeiro + k;
+                // Soma com a mesma volta em 32 bits que _mm_add_epi32 em construir_grafo_matriz
+                aresta->valor = (int)((unsigned int)valores[j] + (unsigned int)valores[k]);
+                aresta++;
+            }
+        }
+    }
+    construtor->linhas++;
+    return true;
+}
+
+/**
+ * @brief Preenche as arestas de coluna e liga as listas dos vertices de um intervalo de linhas
+ *
+ * As arestas de linha de todos os vertices ocupam o inicio de bloco_arestas e as de coluna o
+ * resto; cada vertice fica com as de linha seguidas das de coluna, como em construir_grafo_matriz.
+ */
+static DWORD WINAPI ligar_linhas(LPVOID parametro) {
+    TrabalhoLigacao* trabalho = (TrabalhoLigacao*)parametro;
+    Grafo* grafo = trabalho->grafo;
+    int linhas = trabalho->linhas;
+    int colunas = trabalho->colunas;
+    size_t num_vertices = (size_t)linhas * colunas;
+
+    for (int i = trabalho->linha_inicio; i < trabalho->linha_fim; ++i) {
+        for (int j = 0; j < colunas; ++j) {
+            int v = i * colunas + j;
+            No* no = &grafo->bloco_nos[v];
+            grafo->lista_adj[v] = no;
+
+            Aresta* da_linha = grafo->bloco_arestas + (size_t)v * (colunas - 1);
+            Aresta* da_coluna = grafo->bloco_arestas + num_vertices * (colunas - 1) + (size_t)v * (linhas - 1);
+            const int* coluna = trabalho->transposta + (size_t)j * linhas;
+            Aresta* aresta = da_coluna;
+            for (int k = 0; k < linhas; ++k) {
+                if (k != i) {
+                    aresta->origem = v;
+                    aresta->destino = k * colunas + j;
+                    aresta->valor = (int)((unsigned int)no->valor + (unsigned int)coluna[k]);
+                    aresta->prox = aresta + 1;
+                    aresta++;
+                }
+            }
+            if (linhas > 1) {
+                (aresta - 1)->prox = NULL;
+            }
+            for (int k = 0; k < colunas - 1; ++k) {
+                da_linha[k].prox = k + 1 < colunas - 1 ? &da_linha[k + 1] : (linhas > 1 ? da_coluna : NULL);
+            }
+            no->lista_arestas = colunas > 1 ? da_linha : (linhas > 1 ? da_coluna : NULL);
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Depois da ultima linha: junta as arestas num so bloco e liga as colunas em paralelo
+ */
+static bool finalizar_construcao(Construtor* construtor, int num_threads) {
+    Grafo* grafo = construtor->grafo;
+    int linhas = construtor->linhas;
+    int colunas = construtor->colunas;
+    size_t num_vertices = (size_t)linhas * colunas;
+    size_t grau = (size_t)(colunas - 1) + (size_t)(linhas - 1);
+    if (grau > 0 && num_vertices > SIZE_MAX / sizeof(Aresta) / grau) {
+        return false;
+    }
+    size_t total_arestas = num_vertices * grau;
+
+    Aresta* arestas = (Aresta*)realloc(construtor->arestas, (total_arestas > 0 ? total_arestas : 1) * sizeof(Aresta));
+    if (arestas == NULL) {
+        return false;
+    }
+    construtor->arestas = NULL;
+    grafo->bloco_arestas = arestas;
+    No* nos = (No*)realloc(grafo->bloco_nos, num_vertices * sizeof(No));
+    if (nos != NULL) {
+        grafo->bloco_nos = nos;
+    }
+    grafo->tamanho_bloco_arestas = total_arestas;
+    grafo->tamanho_bloco_nos = (int)num_vertices;
+    grafo->lista_adj = (No**)malloc(num_vertices * sizeof(No*));
+    int* transposta = (int*)malloc(num_vertices * sizeof(int));
+    if (num_threads > linhas) {
+        num_threads = linhas;
+    }
+    TrabalhoLigacao* trabalhos = (TrabalhoLigacao*)calloc(num_threads, sizeof(TrabalhoLigacao));
+    HANDLE* threads = (HANDLE*)calloc(num_threads, sizeof(HANDLE));
+    bool sucesso = grafo->lista_adj != NULL && transposta != NULL && trabalhos != NULL && threads != NULL;
+
+    if (sucesso) {
+        for (int i = 0; i < linhas; ++i) {
+            for (int j = 0; j < colunas; ++j) {
+                transposta[(size_t)j * linhas + i] = grafo->bloco_nos[(size_t)i * colunas + j].valor;
+            }
+        }
+        for (int t = 0; t < num_threads; ++t) {
+            trabalhos[t].grafo = grafo;
+            trabalhos[t].transposta = transposta;
+            trabalhos[t].linhas = linhas;
+            trabalhos[t].colunas = colunas;
+            trabalhos[t].linha_inicio = (int)((long long)linhas * t / num_threads);
+            trabalhos[t].linha_fim = (int)((long long)linhas * (t + 1) / num_threads);
+        }
+        int criadas = 0;
+        for (int t = 1; t < num_threads; ++t) {
+            threads[criadas] = CreateThread(NULL, 0, ligar_linhas, &trabalhos[t], 0, NULL);
+            if (threads[criadas] == NULL) {
+                ligar_linhas(&trabalhos[t]);
+            }
+            else {
+                criadas++;
+            }
+        }
+        ligar_linhas(&trabalhos[0]);
+        if (criadas > 0) {
+            WaitForMultipleObjects(criadas, threads, TRUE, INFINITE);
+        }
+        for (int t = 0; t < criadas; ++t) {
+            CloseHandle(threads[t]);
+        }
+        grafo->num_vertices = (int)num_vertices;
+    }
+
+    free(trabalhos);
+    free(threads);
+    free(transposta);
+    return sucesso;
+}
+#pragma endregion
+
+
+#pragma region Ingerir Matriz
+/**
+ * @brief Le uma matriz de um ficheiro de texto e constroi o grafo enquanto o ficheiro e lido
+ *
+ * O ficheiro tem uma linha da matriz por linha, com os valores separados por ';' (o formato de
+ * matriz.txt). Uma thread le o ficheiro em blocos de INGESTAO_TAMANHO_BLOCO bytes, num_threads
+ * threads convertem os blocos em linhas de inteiros e a thread que chama a funcao acrescenta, por
+ * ordem, os vertices e as arestas de cada linha assim que ela chega. As arestas de coluna so
+ * podem ser criadas quando se conhece o numero de linhas, e sao ligadas em paralelo no fim.
+ * As etapas estao ligadas por filas limitadas, pelo que a memoria usada pelo texto em transito
+ * nao depende do tamanho do ficheiro.
+ *
+ * O grafo obtido e igual ao de construir_grafo_matriz sobre a mesma matriz.
+ *
+ * @param nome_ficheiro Nome do ficheiro com a matriz
+ * @param num_threads Numero de threads de conversao (<= 0 para usar todos os processadores)
+ * @return Ponteiro para o grafo construido, ou NULL se o ficheiro nao existir, estiver vazio,
+ *         tiver linhas com numeros de valores diferentes ou ocorrer um erro
+ *
+ * @autor Diogo Oliveira
+ */
+Grafo* ingerir_matriz(const char* nome_ficheiro, int num_threads) {
+    if (nome_ficheiro == NULL) {
+        return NULL;
+    }
+    if (num_threads <= 0) {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        num_threads = (int)info.dwNumberOfProcessors;
+    }
+    if (num_threads > INGESTAO_MAX_THREADS) {
+        num_threads = INGESTAO_MAX_THREADS;
+    }
+
+    Ingestao ingestao;
+    ingestao.arquivo = fopen(nome_ficheiro, "rb");
+    if (!ingestao.arquivo) {
+        return NULL;
+    }
+    ingestao.conversores_ativos = num_threads;
+    ingestao.erro = 0;
+    ingestao.blocos.itens = NULL;
+    ingestao.lotes.itens = NULL;
+    Construtor construtor = { 0 };
+    construtor.grafo = criar_grafo();
+    HANDLE threads[INGESTAO_MAX_THREADS + 1];
+    int criadas = 0;
+    if (construtor.grafo == NULL ||
+        !iniciar_fila_limitada(&ingestao.blocos, num_threads * INGESTAO_BLOCOS_POR_THREAD) ||
+        !iniciar_fila_limitada(&ingestao.lotes, num_threads * INGESTAO_BLOCOS_POR_THREAD) ||
+        (threads[criadas] = CreateThread(NULL, 0, ler_blocos, &ingestao, 0, NULL)) == NULL) {
+        free(ingestao.blocos.itens);
+        free(ingestao.lotes.itens);
+        destruir_grafo(construtor.grafo);
+        fclose(ingestao.arquivo);
+        return NULL;
+    }
+    criadas++;
+    for (int t = 0; t < num_threads; ++t) {
+        threads[criadas] = CreateThread(NULL, 0, converter_blocos, &ingestao, 0, NULL);
+        if (threads[criadas] != NULL) {
+            criadas++;
+        }
+        else {
+            InterlockedDecrement(&ingestao.conversores_ativos);
+        }
+    }
+    if (criadas == 1) {
+        // Nenhuma thread de conversao: desistir e esvaziar a fila para a leitura terminar
+        InterlockedExchange(&ingestao.erro, 1);
+        BlocoTexto* bloco;
+        while ((bloco = (BlocoTexto*)retirar_fila_limitada(&ingestao.blocos)) != NULL) {
+            libertar_bloco(bloco);
+        }
+        fechar_fila_limitada(&ingestao.lotes);
+    }
+
+    // Construcao: os lotes sao aplicados pela ordem dos blocos; os que chegam antes da vez esperam
+    LoteLinhas* pendentes = NULL;
+    int proximo = 0;
+    LoteLinhas* lote;
+    while ((lote = (LoteLinhas*)retirar_fila_limitada(&ingestao.lotes)) != NULL) {
+        if (ingestao.erro) {
+            libertar_lote(lote);
+            continue;
+        }
+        LoteLinhas** ligacao = &pendentes;
+        while (*ligacao != NULL && (*ligacao)->sequencia < lote->sequencia) {
+            ligacao = &(*ligacao)->prox;
+        }
+        lote->prox = *ligacao;
+        *ligacao = lote;
+        while (pendentes != NULL && pendentes->sequencia == proximo) {
+            lote = pendentes;
+            pendentes = lote->prox;
+            const int* valores = lote->valores;
+            for (int l = 0; l < lote->num_linhas && !ingestao.erro; ++l) {
+                if (!adicionar_linha(&construtor, valores, lote->contagens[l])) {
+                    InterlockedExchange(&ingestao.erro, 1);
+                }
+                valores += lote->contagens[l];
+            }
+            libertar_lote(lote);
+            proximo++;
+        }
+    }
+    while (pendentes != NULL) {
+        // Ficou um bloco por converter: houve um erro
+        lote = pendentes;
+        pendentes = lote->prox;
+        libertar_lote(lote);
+        InterlockedExchange(&ingestao.erro, 1);
+    }
+
+    WaitForMultipleObjects(criadas, threads, TRUE, INFINITE);
+    for (int t = 0; t < criadas; ++t) {
+        CloseHandle(threads[t]);
+    }
+    free(ingestao.blocos.itens);
+    free(ingestao.lotes.itens);
+    fclose(ingestao.arquivo);
+
+    if (ingestao.erro || construtor.linhas == 0 || !finalizar_construcao(&construtor, num_threads)) {
+        free(construtor.arestas);
+        destruir_grafo(construtor.grafo);
+        return NULL;
+    }
+    return construtor.grafo;
+}
+#pragma endregion
@@ -0,0 +1,658 @@
+﻿/*******************************************************************************************************************
+* @file marcos.c
+* @brief Oraculo de distancias por vertices marco (ALT: A*, marcos e desigualdade triangular)
+** @autor Diogo Oliveira (a20468@alunos.ipca.pt)
+* Este ficheiro contém a implementação das seguintes funcionalidades:
+* - Calculo em paralelo das distancias de e para cada marco (uma BFS por marco e sentido)
+* - Limites inferior e superior da distancia entre dois vertices em O(k)
+* - Procura A* com a heuristica dada pelos marcos
+* - Gravacao e leitura das tabelas junto ao ficheiro binario do grafo
+* @date maio 2024
+*
+* @copyright Copyright (c) 2024
+*
+*******************************************************************************************************************/
+
+
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "grafo.h"
+#include "bfs.h"
+#include "compacto.h"
+#include "marcos.h"
+
+
+/**
+ * @brief Estado de cada thread: a fila/ordem da BFS e o contador partilhado de tarefas
+ *
+ * A tarefa j < k e a BFS a partir do marco j no grafo; a tarefa k + j e a BFS a partir do marco j
+ * no grafo invertido. Cada tarefa escreve numa coluna propria, sem partilha entre threads.
+ */
+typedef struct TrabalhoMarcos {
+    GrafoCompacto* direto;        /**< Grafo em CSR, apenas lido */
+    GrafoCompacto* inverso;       /**< Grafo invertido em CSR, apenas lido */
+    const int* marcos;            /**< Vertices marco */
+    int num_marcos;               /**< Numero de marcos */
+    int* colunas;                 /**< 2k colunas de num_vertices distancias */
+    volatile LONG* proxima_tarefa; /**< Contador partilhado com a proxima tarefa a executar */
+    int* ordem;                   /**< Fila da BFS */
+} TrabalhoMarcos;
+
+/**
+ * @brief Entrada da fila de prioridade do A*
+ */
+typedef struct EntradaAEstrela {
+    int prioridade; /**< Distancia desde o inicio mais o limite inferior ate ao destino */
+    int distancia;  /**< Distancia desde o inicio quando foi inserida */
+    int vertice;    /**< Vertice */
+} EntradaAEstrela;
+
+
+#pragma region Funcoes Auxiliares
+/**
+ * @brief Constroi o grafo invertido (todas as arestas com o sentido trocado) em CSR
+ */
+static GrafoCompacto* inverter_compacto(const GrafoCompacto* direto) {
+    int n = direto->num_vertices;
+    int m = direto->num_arestas;
+    GrafoCompacto* inverso = (GrafoCompacto*)calloc(1, sizeof(GrafoCompacto));
+    if (inverso == NULL) {
+        return NULL;
+    }
+    inverso->num_vertices = n;
+    inverso->num_arestas = m;
+    inverso->inicio = (int*)calloc((size_t)n + 1, sizeof(int));
+    inverso->destino = (int*)malloc((m > 0 ? m : 1) * sizeof(int));
+    inverso->valor = (int*)malloc((m > 0 ? m : 1) * sizeof(int));
+    if (inverso->inicio == NULL || inverso->destino == NULL || inverso->valor == NULL) {
+        destruir_grafo_compacto(inverso);
+        return NULL;
+    }
+    for (int k = 0; k < m; ++k) {
+        inverso->inicio[direto->destino[k] + 1]++;
+    }
+    for (int v = 0; v < n; ++v) {
+        inverso->inicio[v + 1] += inverso->inicio[v];
+    }
+    // inicio[v] serve de cursor durante o preenchimento e e reposto no fim
+    for (int v = 0; v < n; ++v) {
+        for (int k = direto->inicio[v]; k < direto->inicio[v + 1]; ++k) {
+            int posicao = inverso->inicio[direto->destino[k]]++;
+            inverso->destino[posicao] = v;
+            inverso->valor[posicao] = direto->valor[k];
+        }
+    }
+    for (int v = n; v > 0; --v) {
+        inverso->inicio[v] = inverso->inicio[v - 1];
+    }
+    inverso->inicio[0] = 0;
+    return inverso;
+}
+
+/**
+ * @brief BFS a partir de origem, escrevendo as distancias (-1 se inalcancavel) em distancia
+ */
+static void bfs_compacto(const GrafoCompacto* compacto, int origem, int* distancia, int* ordem) {
+    for (int i = 0; i < compacto->num_vertices; ++i) {
+        distancia[i] = -1;
+    }
+    int frente = 0;
+    int tras = 0;
+    distancia[origem] = 0;
+    ordem[tras++] = origem;
+    while (frente < tras) {
+        int v = ordem[frente++];
+        for (int k = compacto->inicio[v]; k < compacto->inicio[v + 1]; ++k) {
+            int w = compacto->destino[k];
+            if (distancia[w] < 0) {
+                distancia[w] = distancia[v] + 1;
+                ordem[tras++] = w;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Funcao executada por cada thread: retira tarefas do contador partilhado ate se esgotarem
+ */
+static DWORD WINAPI executar_trabalho(LPVOID parametro) {
+    TrabalhoMarcos* trabalho = (TrabalhoMarcos*)parametro;
+    int k = trabalho->num_marcos;
+    size_t n = (size_t)trabalho->direto->num_vertices;
+    LONG tarefa;
+    while ((tarefa = InterlockedIncrement(trabalho->proxima_tarefa) - 1) < 2 * k) {
+        const GrafoCompacto* compacto = tarefa < k ? trabalho->direto : trabalho->inverso;
+        bfs_compacto(compacto, trabalho->marcos[tarefa % k], trabalho->colunas + (size_t)tarefa * n, trabalho->ordem);
+    }
+    return 0;
+}
+
+/**
+ * @brief Limite inferior da distancia de v ate t, ou -1 se os marcos provam que t e inalcancavel
+ *
+ * Pela desigualdade triangular, d(v, t) >= d(L, t) - d(L, v) e d(v, t) >= d(v, L) - d(t, L).
+ * Se L alcanca v mas nao t, ou t alcanca L mas v nao, entao v nao alcanca t.
+ */
+static int limite_inferior(const Marcos* marcos, int v, int t) {
+    int k = marcos->num_marcos;
+    const int* de_v = marcos->de_marco + (size_t)v * k;
+    const int* de_t = marcos->de_marco + (size_t)t * k;
+    const int* ate_v = marcos->ate_marco + (size_t)v * k;
+    const int* ate_t = marcos->ate_marco + (size_t)t * k;
+    int limite = 0;
+    for (int i = 0; i < k; ++i) {
+        if (de_v[i] >= 0) {
+            if (de_t[i] < 0) {
+                return -1;
+            }
+            if (de_t[i] - de_v[i] > limite) {
+                limite = de_t[i] - de_v[i];
+            }
+        }
+        if (ate_t[i] >= 0) {
+            if (ate_v[i] < 0) {
+                return -1;
+            }
+            if (ate_v[i] - ate_t[i] > limite) {
+                limite = ate_v[i] - ate_t[i];
+            }
+        }
+    }
+    return limite;
+}
+
+/**
+ * @brief Compara duas entradas: menor prioridade primeiro e, em caso de empate, a mais funda
+ */
+static bool precede(const EntradaAEstrela* a, const EntradaAEstrela* b) {
+    return a->prioridade < b->prioridade || (a->prioridade == b->prioridade && a->distancia > b->distancia);
+}
+
+/**
+ * @brief Insere uma entrada no monte binario, aumentando-o se necessario
+ */
+static bool inserir_monte(EntradaAEstrela** monte, int* tamanho, int* capacidade, EntradaAEstrela entrada) {
+    if (*tamanho == *capacidade) {
+        int nova_capacidade = *capacidade > 0 ? 2 * *capacidade : 64;
+        EntradaAEstrela* novo = (EntradaAEstrela*)realloc(*monte, nova_capacidade * sizeof(EntradaAEstrela));
+        if (novo == NULL) {
+            return false;
+        }
+        *monte = novo;
+        *capacidade = nova_capacidade;
+    }
+    int i = (*tamanho)++;
+    while (i > 0 && precede(&entrada, &(*monte)[(i - 1) / 2])) {
+        (*monte)[i] = (*monte)[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    (*monte)[i] = entrada;
+    return true;
+}
+
+/**
+ * @brief Retira a entrada de menor prioridade do monte binario
+ */
+static EntradaAEstrela retirar_monte(EntradaAEstrela* monte, int* tamanho) {
+    EntradaAEstrela topo = monte[0];
+    EntradaAEstrela ultima = monte[--(*tamanho)];
+    int i = 0;
+    while (2 * i + 1 < *tamanho) {
+        int filho = 2 * i + 1;
+        if (filho + 1 < *tamanho && precede(&monte[filho + 1], &monte[filho])) {
+            filho++;
+        }
+        if (!precede(&monte[filho], &ultima)) {
+            break;
+        }
+        monte[i] = monte[filho];
+        i = filho;
+    }
+    monte[i] = ultima;
+    return topo;
+}
+
+/**
+ * @brief Hash FNV-1a das listas de adjacencia, para confirmar que umas tabelas gravadas correspondem ao grafo
+ *
+ * Cobre o numero de vertices e, para cada vertice, os destinos das suas arestas seguidos de um
+ * separador, pelo que duas listas com o mesmo numero de arestas mas ligacoes diferentes dao
+ * assinaturas diferentes.
+ */
+static unsigned int assinatura_grafo(Grafo* grafo, int* num_arestas) {
+    unsigned int hash = 2166136261u;
+    int total = 0;
+    hash = (hash ^ (unsigned int)grafo->num_vertices) * 16777619u;
+    for (int i = 0; i < grafo->num_vertices; ++i) {
+        for (Aresta* aresta = grafo->lista_adj[i]->lista_arestas; aresta; aresta = aresta->prox) {
+            hash = (hash ^ (unsigned int)aresta->destino) * 16777619u;
+            total++;
+        }
+        hash = (hash ^ 0xFFFFFFFFu) * 16777619u;
+    }
+    *num_arestas = total;
+    return hash;
+}
+
+/**
+ * @brief Aloca uma estrutura Marcos vazia para n vertices e k marcos
+ */
+static Marcos* alocar_marcos(int n, int k) {
+    Marcos* marcos = (Marcos*)calloc(1, sizeof(Marcos));
+    if (marcos == NULL) {
+        return NULL;
+    }
+    size_t tamanho = (size_t)n * k > 0 ? (size_t)n * k : 1;
+    marcos->num_vertices = n;
+    marcos->num_marcos = k;
+    marcos->marcos = (int*)malloc(k * sizeof(int));
+    marcos->de_marco = (int*)malloc(tamanho * sizeof(int));
+    marcos->ate_marco = (int*)malloc(tamanho * sizeof(int));
+    if (marcos->marcos == NULL || marcos->de_marco == NULL || marcos->ate_marco == NULL) {
+        destruir_marcos(marcos);
+        return NULL;
+    }
+    return marcos;
+}
+#pragma endregion
+
+
+#pragma region Criar Marcos
+/**
+ * @brief Escolhe os marcos e calcula em paralelo as distancias de e para cada um
+ *
+ * Sao feitas 2k BFS (uma a partir de cada marco no grafo e outra no grafo invertido), distribuidas
+ * dinamicamente pelas threads. As tabelas ficam validas enquanto grafo->versao nao mudar.
+ *
+ * @param grafo Ponteiro para o grafo
+ * @param escolhidos Vertices a usar como marcos, ou NULL para os espalhar uniformemente pelos
+ *                   indices (numa matriz, linha a linha, ficam distribuidos por toda a matriz)
+ * @param num_marcos Numero de marcos (k)
+ * @param num_threads Numero de threads a usar (<= 0 para usar todos os processadores)
+ * @return Ponteiro para as tabelas, ou NULL em caso de erro
+ *
+ * @autor Diogo Oliveira
+ */
+Marcos* criar_marcos(Grafo* grafo, const int* escolhidos, int num_marcos, int num_threads) {
+    if (grafo == NULL || num_marcos <= 0 || grafo->num_vertices <= 0) {
+        return NULL;
+    }
+    int n = grafo->num_vertices;
+    if (escolhidos == NULL && num_marcos > n) {
+        num_marcos = n;
+    }
+    for (int i = 0; escolhidos != NULL && i < num_marcos; ++i) {
+        if (escolhidos[i] < 0 || escolhidos[i] >= n) {
+            return NULL;
+        }
+    }
+    if (num_threads <= 0) {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        num_threads = (int)info.dwNumberOfProcessors;
+    }
+    if (num_threads > MARCOS_MAX_THREADS) {
+        num_threads = MARCOS_MAX_THREADS;
+    }
+    if (num_threads > 2 * num_marcos) {
+        num_threads = 2 * num_marcos;
+    }
+
+    Marcos* marcos = alocar_marcos(n, num_marcos);
+    GrafoCompacto* direto = compactar_grafo(grafo);
+    GrafoCompacto* inverso = direto != NULL ? inverter_compacto(direto) : NULL;
+    int* colunas = (int*)malloc((size_t)2 * num_marcos * n * sizeof(int));
+    TrabalhoMarcos* trabalhos = (TrabalhoMarcos*)calloc(num_threads, sizeof(TrabalhoMarcos));
+    HANDLE* threads = (HANDLE*)calloc(num_threads, sizeof(HANDLE));
+    bool sucesso = marcos != NULL && inverso != NULL && colunas != NULL && trabalhos != NULL && threads != NULL;
+
+    if (sucesso) {
+        marcos->assinatura = assinatura_grafo(grafo, &marcos->num_arestas);
+        marcos->versao = grafo->versao;
+        for (int i = 0; i < num_marcos; ++i) {
+            marcos->marcos[i] = escolhidos != NULL ? escolhidos[i] : (int)((long long)n * i / num_marcos);
+        }
+    }
+    volatile LONG proxima_tarefa = 0;
+    for (int t = 0; sucesso && t < num_threads; ++t) {
+        trabalhos[t].direto = direto;
+        trabalhos[t].inverso = inverso;
+        trabalhos[t].marcos = marcos->marcos;
+        trabalhos[t].num_marcos = num_marcos;
+        trabalhos[t].colunas = colunas;
+        trabalhos[t].proxima_tarefa = &proxima_tarefa;
+        trabalhos[t].ordem = (int*)malloc(n * sizeof(int));
+        sucesso = trabalhos[t].ordem != NULL;
+    }
+
+    if (sucesso) {
+        // A thread principal faz a parte da primeira thread; as restantes sao criadas
+        int criadas = 0;
+        for (int t = 1; t < num_threads; ++t) {
+            threads[criadas] = CreateThread(NULL, 0, executar_trabalho, &trabalhos[t], 0, NULL);
+            if (threads[criadas] != NULL) {
+                criadas++;
+            }
+        }
+        executar_trabalho(&trabalhos[0]);
+        if (criadas > 0) {
+            WaitForMultipleObjects(criadas, threads, TRUE, INFINITE);
+        }
+        for (int t = 0; t < criadas; ++t) {
+            CloseHandle(threads[t]);
+        }
+
+        // Passar das colunas por marco para linhas por vertice
+        for (int i = 0; i < num_marcos; ++i) {
+            const int* de = colunas + (size_t)i * n;
+            const int* ate = colunas + (size_t)(num_marcos + i) * n;
+            for (int v = 0; v < n; ++v) {
+                marcos->de_marco[(size_t)v * num_marcos + i] = de[v];
+                marcos->ate_marco[(size_t)v * num_marcos + i] = ate[v];
+            }
+        }
+    }
+
+    for (int t = 0; trabalhos != NULL && t < num_threads; ++t) {
+        free(trabalhos[t].ordem);
+    }
+    free(trabalhos);
+    free(threads);
+    free(colunas);
+    destruir_grafo_compacto(inverso);
+    destruir_grafo_compacto(direto);
+    if (!sucesso) {
+        destruir_marcos(marcos);
+        return NULL;
+    }
+    return marcos;
+}
+#pragma endregion
+
+
+#pragma region Destruir Marcos
+/**
+ * @brief Liberta as tabelas de marcos
+ *
+ * @param marcos Ponteiro para as tabelas
+ * @return true se foram destruidas com sucesso, false caso contrario
+ *
+ * @autor Diogo Oliveira
+ */
+bool destruir_marcos(Marcos* marcos) {
+    if (marcos == NULL) {
+        return false;
+    }
+    free(marcos->marcos);
+    free(marcos->de_marco);
+    free(marcos->ate_marco);
+    free(marcos);
+    return true;
+}
+#pragma endregion
+
+
+#pragma region Limites Marcos
+/**
+ * @brief Limites da distancia (em arestas) de origem ate destino, em O(k)
+ *
+ * Os limites referem-se ao grafo na versao marcos->versao.
+ *
+ * @param marcos Ponteiro para as tabelas
+ * @param origem Vertice de origem
+ * @param destino Vertice de destino
+ * @param minimo Onde e escrito o limite inferior
+ * @param maximo Onde e escrito o limite superior, ou -1 se nenhum marco o fornecer
+ * @return false se os marcos provam que nao existe caminho ou os argumentos sao invalidos,
+ *         true caso contrario
+ *
+ * @autor Diogo Oliveira
+ */
+bool marcos_limites(Marcos* marcos, int origem, int destino, int* minimo, int* maximo) {
+    if (marcos == NULL || minimo == NULL || maximo == NULL || origem < 0 || destino < 0 ||
+        origem >= marcos->num_vertices || destino >= marcos->num_vertices) {
+        return false;
+    }
+    int limite = limite_inferior(marcos, origem, destino);
+    if (limite < 0) {
+        return false;
+    }
+
+    // d(origem, destino) <= d(origem, L) + d(L, destino)
+    int k = marcos->num_marcos;
+    const int* ate_origem = marcos->ate_marco + (size_t)origem * k;
+    const int* de_destino = marcos->de_marco + (size_t)destino * k;
+    int superior = -1;
+    for (int i = 0; i < k; ++i) {
+        if (ate_origem[i] >= 0 && de_destino[i] >= 0 &&
+            (superior < 0 || ate_origem[i] + de_destino[i] < superior)) {
+            superior = ate_origem[i] + de_destino[i];
+        }
+    }
+    *minimo = limite;
+    *maximo = superior;
+    return true;
+}
+#pragma endregion
+
+
+#pragma region Caminho Marcos
+/**
+ * @brief Caminho mais curto (em arestas) por A*, com a heuristica dos marcos
+ *
+ * Da o mesmo numero de vertices que bfs_obter_caminho, visitando em geral muito menos vertices.
+ * Se o grafo mudou desde que as tabelas foram calculadas, a heuristica deixa de ser valida e
+ * o caminho e calculado por bfs_obter_caminho. Os resultados do A* nao entram na cache de
+ * caminhos do grafo: podem ser um caminho diferente, com o mesmo comprimento mas outra soma,
+ * do que bfs_obter_caminho guarda para o mesmo par.
+ *
+ * @param marcos Ponteiro para as tabelas
+ * @param grafo Ponteiro para o grafo
+ * @param inicio Vertice de inicio
+ * @param destino Vertice de destino
+ * @param caminho Array onde sao escritos os vertices do caminho, de inicio para destino
+ * @param capacidade Tamanho do array caminho (num_vertices chega sempre)
+ * @param soma Onde e escrita a soma dos valores dos vertices do caminho, ou -1 (pode ser NULL)
+ * @return O numero de vertices do caminho, 0 se nao existir caminho, ou -1 em caso de erro
+ *
+ * @autor Diogo Oliveira
+ */
+int marcos_caminho(Marcos* marcos, Grafo* grafo, int inicio, int destino, int* caminho, int capacidade, int* soma) {
+    if (grafo == NULL || caminho == NULL || inicio < 0 || destino < 0 ||
+        inicio >= grafo->num_vertices || destino >= grafo->num_vertices) {
+        return -1;
+    }
+    if (marcos == NULL || marcos->versao != grafo->versao || marcos->num_vertices != grafo->num_vertices) {
+        return bfs_obter_caminho(grafo, inicio, destino, caminho, capacidade, soma);
+    }
+    int n = grafo->num_vertices;
+    int limite = limite_inferior(marcos, inicio, destino);
+    if (limite < 0) {
+        if (soma != NULL) {
+            *soma = -1;
+        }
+        return 0;
+    }
+
+    int* distancia = (int*)malloc(n * sizeof(int));
+    int* predecessores = (int*)malloc(n * sizeof(int));
+    EntradaAEstrela* monte = NULL;
+    int tamanho_monte = 0;
+    int capacidade_monte = 0;
+    if (distancia == NULL || predecessores == NULL) {
+        free(distancia);
+        free(predecessores);
+        return -1;
+    }
+    for (int i = 0; i < n; ++i) {
+        distancia[i] = -1;
+        predecessores[i] = -1;
+    }
+
+    // Como a heuristica e consistente, um vertice retirado com a distancia atual ja e definitivo
+    bool erro = false;
+    distancia[inicio] = 0;
+    EntradaAEstrela entrada = { limite, 0, inicio };
+    erro = !inserir_monte(&monte, &tamanho_monte, &capacidade_monte, entrada);
+    while (!erro && tamanho_monte > 0) {
+        EntradaAEstrela atual = retirar_monte(monte, &tamanho_monte);
+        if (atual.distancia != distancia[atual.vertice]) {
+            continue;
+        }
+        if (atual.vertice == destino) {
+            break;
+        }
+        for (Aresta* aresta = grafo->lista_adj[atual.vertice]->lista_arestas; aresta && !erro; aresta = aresta->prox) {
+            int vizinho = aresta->destino;
+            int nova = atual.distancia + 1;
+            if (distancia[vizinho] >= 0 && distancia[vizinho] <= nova) {
+                continue;
+            }
+            int estimativa = limite_inferior(marcos, vizinho, destino);
+            if (estimativa < 0) {
+                continue;
+            }
+            distancia[vizinho] = nova;
+            predecessores[vizinho] = atual.vertice;
+            EntradaAEstrela seguinte = { nova + estimativa, nova, vizinho };
+            erro = !inserir_monte(&monte, &tamanho_monte, &capacidade_monte, seguinte);
+        }
+    }
+
+    int total = -1;
+    int tamanho_caminho = 0;
+    if (erro) {
+        tamanho_caminho = -1;
+    }
+    else if (distancia[destino] >= 0) {
+        tamanho_caminho = distancia[destino] + 1;
+        if (tamanho_caminho > capacidade) {
+            tamanho_caminho = -1;
+        }
+        else {
+            total = 0;
+            int atual = destino;
+            int index = tamanho_caminho - 1;
+            while (atual != -1) {
+                caminho[index--] = atual;
+                total += grafo->lista_adj[atual]->valor;
+                atual = predecessores[atual];
+            }
+        }
+    }
+
+    free(distancia);
+    free(predecessores);
+    free(monte);
+
+    if (tamanho_caminho >= 0 && soma != NULL) {
+        *soma = total;
+    }
+    return tamanho_caminho;
+}
+#pragma endregion
+
+
+#pragma region Guardar Marcos
+/**
+ * @brief Grava as tabelas em "<nome_ficheiro>.marcos", junto ao ficheiro de guardar_grafo_binario
+ *
+ * Formato: cabecalho {MARCOS_MARCA, num_vertices, num_arestas, num_marcos, assinatura}, seguido dos marcos e
+ * das tabelas de_marco e ate_marco, tal como estao em memoria.
+ *
+ * @param marcos Ponteiro para as tabelas
+ * @param nome_ficheiro Nome do ficheiro binario do grafo
+ * @return true se foram gravadas com sucesso, false caso contrario
+ *
+ * @autor Diogo Oliveira
+ */
+bool guardar_marcos(Marcos* marcos, const char* nome_ficheiro) {
+    if (marcos == NULL || nome_ficheiro == NULL) {
+        return false;
+    }
+    char nome[260];
+    snprintf(nome, sizeof(nome), "%s.marcos", nome_ficheiro);
+    FILE* arquivo = fopen(nome, "wb");
+    if (!arquivo) {
+        return false;
+    }
+    size_t tamanho = (size_t)marcos->num_vertices * marcos->num_marcos;
+    int cabecalho[5] = { MARCOS_MARCA, marcos->num_vertices, marcos->num_arestas, marcos->num_marcos, (int)marcos->assinatura };
+    bool sucesso = fwrite(cabecalho, sizeof(int), 5, arquivo) == 5 &&
+        fwrite(marcos->marcos, sizeof(int), marcos->num_marcos, arquivo) == (size_t)marcos->num_marcos &&
+        fwrite(marcos->de_marco, sizeof(int), tamanho, arquivo) == tamanho &&
+        fwrite(marcos->ate_marco, sizeof(int), tamanho, arquivo) == tamanho;
+    if (fclose(arquivo) != 0) {
+        sucesso = false;
+    }
+    return sucesso;
+}
+#pragma endregion
+
+
+#pragma region Carregar Marcos
+/**
+ * @brief Le as tabelas gravadas por guardar_marcos para o grafo carregado do mesmo ficheiro
+ *
+ * As tabelas so sao aceites se o numero de vertices, o numero de arestas e a assinatura das
+ * listas de adjacencia coincidirem com os do grafo e se os marcos e as distancias lidas forem
+ * validos. Ficam associadas a versao atual do grafo.
+ *
+ * @param grafo Grafo carregado de nome_ficheiro
+ * @param nome_ficheiro Nome do ficheiro binario do grafo
+ * @return Ponteiro para as tabelas, ou NULL se nao existirem, nao corresponderem ao grafo ou
+ *         ocorrer um erro
+ *
+ * @autor Diogo Oliveira
+ */
+Marcos* carregar_marcos(Grafo* grafo, const char* nome_ficheiro) {
+    if (grafo == NULL || nome_ficheiro == NULL) {
+        return NULL;
+    }
+    char nome[260];
+    snprintf(nome, sizeof(nome), "%s.marcos", nome_ficheiro);
+    FILE* arquivo = fopen(nome, "rb");
+    if (!arquivo) {
+        return NULL;
+    }
+    int num_arestas;
+    unsigned int assinatura = assinatura_grafo(grafo, &num_arestas);
+    int cabecalho[5];
+    if (fread(cabecalho, sizeof(int), 5, arquivo) != 5 || cabecalho[0] != MARCOS_MARCA ||
+        cabecalho[1] != grafo->num_vertices || cabecalho[2] != num_arestas || cabecalho[3] <= 0 ||
+        (unsigned int)cabecalho[4] != assinatura) {
+        fclose(arquivo);
+        return NULL;
+    }
+    Marcos* marcos = alocar_marcos(cabecalho[1], cabecalho[3]);
+    if (marcos == NULL) {
+        fclose(arquivo);
+        return NULL;
+    }
+    marcos->num_arestas = cabecalho[2];
+    marcos->assinatura = assinatura;
+    marcos->versao = grafo->versao;
+    size_t tamanho = (size_t)marcos->num_vertices * marcos->num_marcos;
+    bool sucesso = fread(marcos->marcos, sizeof(int), marcos->num_marcos, arquivo) == (size_t)marcos->num_marcos &&
+        fread(marcos->de_marco, sizeof(int), tamanho, arquivo) == tamanho &&
+        fread(marcos->ate_marco, sizeof(int), tamanho, arquivo) == tamanho;
+    fclose(arquivo);
+    // Um marco fora do grafo ou uma distancia negativa tornariam os limites (e o A*) incorretos
+    for (int i = 0; sucesso && i < marcos->num_marcos; ++i) {
+        int marco = marcos->marcos[i];
+        sucesso = marco >= 0 && marco < marcos->num_vertices &&
+            marcos->de_marco[(size_t)marco * marcos->num_marcos + i] == 0 &&
+            marcos->ate_marco[(size_t)marco * marcos->num_marcos + i] == 0;
+    }
+    for (size_t i = 0; sucesso && i < tamanho; ++i) {
+        sucesso = marcos->de_marco[i] >= -1 && marcos->ate_marco[i] >= -1;
+    }
+    if (!sucesso) {
+        destruir_marcos(marcos);
+        return NULL;
+    }
+    return marcos;
+}
+#pragma endregion
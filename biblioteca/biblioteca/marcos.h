@@ -0,0 +1,47 @@
+﻿/*******************************************************************************************************************
+* @file marcos.h
+* @author Diogo Oliveira (a20468@alunos.ipca.pt)
+* @brief header responsável pela definiçao das tabelas de distancias a vertices marco (ALT)
+* @date maio 2024 *
+*
+* @copyright Copyright (c) 2024
+*
+*******************************************************************************************************************/
+
+
+#ifndef MARCOS_H
+#define MARCOS_H
+
+#include <stdbool.h>
+#include "grafo.h"
+
+#define MARCOS_MAX_THREADS 64         /**< Limite de WaitForMultipleObjects */
+#define MARCOS_MARCA 0x534F4352       /**< Identifica os ficheiros .marcos */
+
+/**
+ * @brief Distancias de e para um conjunto de vertices marco, usadas como limites e heuristica A*
+ *
+ * As tabelas estao organizadas por vertice: as distancias de v aos k marcos ocupam as posicoes
+ * [v * k, (v + 1) * k), para que cada consulta leia uma unica zona contigua.
+ *
+ * @autor Diogo Oliveira
+ */
+typedef struct Marcos {
+    int num_vertices;     /**< Numero de vertices do grafo quando as tabelas foram calculadas */
+    int num_arestas;      /**< Numero de arestas do grafo quando as tabelas foram calculadas */
+    int num_marcos;       /**< Numero de marcos (k) */
+    int* marcos;          /**< Indices dos vertices marco */
+    int* de_marco;        /**< de_marco[v * k + i]: distancia do marco i ate v (-1 se inalcancavel) */
+    int* ate_marco;       /**< ate_marco[v * k + i]: distancia de v ate ao marco i (-1 se inalcancavel) */
+    unsigned long long versao; /**< Versao do grafo a que as tabelas correspondem */
+    unsigned int assinatura; /**< Hash das listas de adjacencia, gravado para validar o ficheiro */
+} Marcos;
+
+
+Marcos* criar_marcos(Grafo* grafo, const int* escolhidos, int num_marcos, int num_threads);
+bool destruir_marcos(Marcos* marcos);
+bool marcos_limites(Marcos* marcos, int origem, int destino, int* minimo, int* maximo);
+int marcos_caminho(Marcos* marcos, Grafo* grafo, int inicio, int destino, int* caminho, int capacidade, int* soma);
+bool guardar_marcos(Marcos* marcos, const char* nome_ficheiro);
+Marcos* carregar_marcos(Grafo* grafo, const char* nome_ficheiro);
+#endif /* MARCOS_H */